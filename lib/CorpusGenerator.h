@@ -0,0 +1,367 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace utils {
+
+/**
+ * Deterministic generator of shaped JSON workloads.
+ *
+ * A document is a top level array which is filled with the shape specific elements
+ * until the requested size is reached, the same seed always gives the same bytes.
+ * The output is produced in chunks, so documents of any size can be streamed to a file.
+ *
+ * IMPORTANT:
+ * - Numbers are generated without exponents.
+ * - The depth of the deep elements grows with the document size up to NESTING_DEPTH, a document
+ *   holds at least NESTING_ELEMENTS of them, so the small sizes are not a single oversized element.
+ */
+class CorpusGenerator {
+public:
+
+	enum class Shape : uint8_t {
+		Records,
+		DeepNesting,
+		WideObjects,
+		LongStrings,
+		EscapedStrings,
+		Integers,
+		Floats,
+		Count
+	};
+
+	enum class Layout : uint8_t {
+		Minified,
+		Pretty
+	};
+
+	static constexpr size_t CHUNK_SIZE = 1024u * 1024u;
+	static constexpr unsigned NESTING_DEPTH = 256u;
+	static constexpr unsigned NESTING_ELEMENTS = 8u;
+	static constexpr unsigned WIDE_OBJECT_KEYS = 1024u;
+	static constexpr unsigned LONG_STRING_MAX = 16u * 1024u;
+
+private:
+
+	const Shape _shape;
+	const Layout _layout;
+	uint64_t _state;
+	std::string _out;
+	unsigned _depth;
+	unsigned _nesting_depth;
+	bool _first_item;
+
+public:
+
+	CorpusGenerator(Shape shape, Layout layout, uint64_t seed = 1u) noexcept :
+		_shape(shape), _layout(layout), _state(seed), _depth(0), _nesting_depth(NESTING_DEPTH), _first_item(true) {}
+
+	/**
+	 * Generates a document of at least 'size' bytes and passes it to 'sink' in chunks.
+	 * @param sink - void(std::string_view chunk)
+	 */
+	template <typename F>
+	void generate(size_t size, F&& sink) {
+		size_t produced = 0;
+		_out.clear();
+		_depth = 0;
+		_nesting_depth = nesting_depth(size);
+		open('[');
+		while(produced + _out.size() < size) {
+			item();
+			element();
+			if(_out.size() >= CHUNK_SIZE) {
+				produced += _out.size();
+				sink(std::string_view(_out));
+				_out.clear();
+			}
+		}
+		close(']');
+		if(_layout == Layout::Pretty) {
+			_out.push_back('\n');
+		}
+		sink(std::string_view(_out));
+		_out.clear();
+	}
+
+	std::string generate(size_t size) {
+		std::string result;
+		result.reserve(size + CHUNK_SIZE / 16u);
+		generate(size, [&result](std::string_view chunk) { result.append(chunk); });
+		return result;
+	}
+
+	/**
+	 * @return false if the file could not be written.
+	 */
+	bool generate(size_t size, FILE* file) {
+		bool result = true;
+		generate(size, [&result, file](std::string_view chunk) {
+			result = result && fwrite(chunk.data(), 1u, chunk.size(), file) == chunk.size();
+		});
+		return result;
+	}
+
+	static const char* to_string(Shape shape) noexcept {
+		switch(shape) {
+			case Shape::Records:
+				return "records";
+			case Shape::DeepNesting:
+				return "deep";
+			case Shape::WideObjects:
+				return "wide";
+			case Shape::LongStrings:
+				return "strings";
+			case Shape::EscapedStrings:
+				return "escaped";
+			case Shape::Integers:
+				return "integers";
+			case Shape::Floats:
+				return "floats";
+			default:
+				return "unknown";
+		}
+	}
+
+	static const char* to_string(Layout layout) noexcept {
+		return layout == Layout::Pretty ? "pretty" : "minified";
+	}
+
+	static bool from_string(const char* name, Shape& shape) noexcept {
+		for(uint8_t i = 0; i < uint8_t(Shape::Count); ++i) {
+			if(strcmp(name, to_string(Shape(i))) == 0) {
+				shape = Shape(i);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static bool from_string(const char* name, Layout& layout) noexcept {
+		if(strcmp(name, "minified") == 0) {
+			layout = Layout::Minified;
+		} else if(strcmp(name, "pretty") == 0) {
+			layout = Layout::Pretty;
+		} else {
+			return false;
+		}
+		return true;
+	}
+
+private:
+
+	uint64_t random() noexcept {
+		// splitmix64
+		uint64_t z = (_state += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30u)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27u)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31u);
+	}
+
+	uint64_t random(uint64_t limit) noexcept {
+		return random() % limit;
+	}
+
+	void element() {
+		switch(_shape) {
+			case Shape::Records:
+				record();
+				break;
+
+			case Shape::DeepNesting:
+				nesting(_nesting_depth);
+				break;
+
+			case Shape::WideObjects:
+				wide_object();
+				break;
+
+			case Shape::LongStrings:
+				string(1u + random(LONG_STRING_MAX), false);
+				break;
+
+			case Shape::EscapedStrings:
+				string(1u + random(LONG_STRING_MAX), true);
+				break;
+
+			case Shape::Integers:
+				integer();
+				break;
+
+			case Shape::Floats:
+				floating();
+				break;
+
+			default:
+				_out.append("null");
+				break;
+		}
+	}
+
+	void record() {
+		open('{');
+		key("id");
+		integer();
+		key("name");
+		string(4u + random(24u), false);
+		key("active");
+		_out.append(random(2u) ? "true" : "false");
+		key("score");
+		floating();
+		key("parent");
+		if(random(4u)) {
+			integer();
+		} else {
+			_out.append("null");
+		}
+		key("tags");
+		open('[');
+		for(uint64_t i = random(5u); i > 0; --i) {
+			item();
+			string(3u + random(8u), false);
+		}
+		close(']');
+		close('}');
+	}
+
+	void nesting(unsigned depth) {
+		for(unsigned level = 0; level < depth; ++level) {
+			if(level & 1u) {
+				open('[');
+				item();
+			} else {
+				open('{');
+				key("level");
+			}
+		}
+		integer();
+		for(unsigned level = depth; level > 0; --level) {
+			close((level - 1u) & 1u ? ']' : '}');
+		}
+	}
+
+	/**
+	 * @return The deepest nesting up to NESTING_DEPTH which fits NESTING_ELEMENTS times to the size,
+	 * at least one level.
+	 */
+	unsigned nesting_depth(size_t size) const noexcept {
+		// An integer takes up to 20 bytes, the element starts inside of the top level array.
+		const size_t limit = size / NESTING_ELEMENTS;
+		size_t element_size = 20u;
+		unsigned depth = 0;
+		while(depth < NESTING_DEPTH) {
+			const size_t level = depth + 1u;
+			// The bracket, the key of an object, the closing bracket and a new line with an indent before each.
+			size_t level_size = 2u + ((depth & 1u) ? 0u : (_layout == Layout::Pretty ? 9u : 8u));
+			if(_layout == Layout::Pretty) {
+				level_size += 1u + (level + 1u) + 1u + level;
+			}
+			if(depth > 0 && element_size + level_size > limit) {
+				break;
+			}
+			element_size += level_size;
+			depth++;
+		}
+		return depth;
+	}
+
+	void wide_object() {
+		char name[16];
+		open('{');
+		for(unsigned i = 0; i < WIDE_OBJECT_KEYS; ++i) {
+			snprintf(name, sizeof(name), "field_%04u", i);
+			key(name);
+			switch(random(4u)) {
+				case 0:
+					integer();
+					break;
+				case 1:
+					floating();
+					break;
+				case 2:
+					string(1u + random(16u), false);
+					break;
+				default:
+					_out.append(random(2u) ? "true" : "false");
+					break;
+			}
+		}
+		close('}');
+	}
+
+	void string(size_t len, bool escaped) {
+		static constexpr char ALPHABET[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 _-.";
+		static constexpr const char* ESCAPES[] = {"\\\"", "\\\\", "\\/", "\\b", "\\f", "\\n", "\\r", "\\t", "\\u00e9"};
+		_out.push_back('"');
+		for(size_t i = 0; i < len; ++i) {
+			const uint64_t rnd = random();
+			if(escaped && (rnd & 7u) == 0) {
+				_out.append(ESCAPES[(rnd >> 3u) % (sizeof(ESCAPES) / sizeof(ESCAPES[0]))]);
+			} else {
+				_out.push_back(ALPHABET[(rnd >> 3u) % (sizeof(ALPHABET) - 1u)]);
+			}
+		}
+		_out.push_back('"');
+	}
+
+	void integer() {
+		const uint64_t rnd = random();
+		int64_t value = int64_t(rnd >> ((rnd & 63u) | 1u));
+		if(rnd & 64u) {
+			value = -value;
+		}
+		_out.append(std::to_string(value));
+	}
+
+	void floating() {
+		char buffer[48];
+		const uint64_t rnd = random();
+		const double value = double(int64_t(rnd >> 16u) - (int64_t(1) << 47u)) / double(1u << (rnd & 31u));
+		const int len = snprintf(buffer, sizeof(buffer), "%.*f", int(1u + (rnd >> 5u) % 12u), value);
+		_out.append(buffer, size_t(len));
+	}
+
+	void open(char bracket) {
+		_out.push_back(bracket);
+		_depth++;
+		_first_item = true;
+	}
+
+	void close(char bracket) {
+		_depth--;
+		if(not _first_item) {
+			newline();
+		}
+		_out.push_back(bracket);
+		_first_item = false;
+	}
+
+	void item() {
+		if(not _first_item) {
+			_out.push_back(',');
+		}
+		_first_item = false;
+		newline();
+	}
+
+	void key(const char* name) {
+		item();
+		_out.push_back('"');
+		_out.append(name);
+		_out.append(_layout == Layout::Pretty ? "\": " : "\":");
+	}
+
+	void newline() {
+		if(_layout == Layout::Pretty) {
+			_out.push_back('\n');
+			_out.append(_depth, '\t');
+		}
+	}
+
+};
+
+}; // namespace utils
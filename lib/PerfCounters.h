@@ -0,0 +1,323 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace utils {
+
+/**
+ * Linux perf_event_open counters of the calling thread, user space only.
+ *
+ * The events are opened in groups, the events of a group are always scheduled together
+ * so their ratios are exact, the values are scaled if the kernel has multiplexed the groups.
+ * An event which can not be opened (no PMU in a VM, perf_event_paranoid, seccomp)
+ * is reported as not available and the rest of the events keep working.
+ */
+class PerfCounters {
+public:
+
+	enum class Event : uint8_t {
+		Cycles,
+		Instructions,
+		BranchMisses,
+		L1dMisses,
+		LlcMisses,
+		DtlbMisses,
+		TaskClock,
+		PageFaults,
+		Count
+	};
+
+	static constexpr size_t EVENT_COUNT = size_t(Event::Count);
+
+	struct Sample {
+		uint64_t value[EVENT_COUNT] = {};
+		bool valid[EVENT_COUNT] = {};
+
+		bool has(Event event) const noexcept {
+			return valid[size_t(event)];
+		}
+
+		uint64_t get(Event event) const noexcept {
+			return value[size_t(event)];
+		}
+
+		/**
+		 * @return Instructions per cycle or a negative value if it is not available.
+		 */
+		double ipc() const noexcept {
+			if(has(Event::Instructions) && has(Event::Cycles) && get(Event::Cycles)) {
+				return double(get(Event::Instructions)) / double(get(Event::Cycles));
+			}
+			return -1.0;
+		}
+
+		/**
+		 * @return Events per KiB of the input or a negative value if it is not available.
+		 */
+		double per_kb(Event event, size_t bytes) const noexcept {
+			if(has(event) && bytes) {
+				return double(get(event)) * 1024.0 / double(bytes);
+			}
+			return -1.0;
+		}
+	};
+
+private:
+
+	struct Group {
+		int leader = -1;
+		std::vector<int> fds;
+		std::vector<Event> events;
+	};
+
+	std::vector<Group> _groups;
+	std::string _error;
+
+public:
+
+	PerfCounters() noexcept = default;
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	~PerfCounters() noexcept {
+		close();
+	}
+
+	/**
+	 * Opens the groups of events, a spec is a comma separated list of groups,
+	 * a group is a '+' separated list of events or a group name.
+	 * Group names : basic, branch, cache, tlb, sw.
+	 * Event names : cycles, instructions, branch-misses, l1d-misses, llc-misses, dtlb-misses,
+	 * task-clock, page-faults.
+	 *
+	 * @return true if at least one event is available, see error() otherwise.
+	 */
+	bool open(const char* spec) {
+		close();
+		std::string str(spec);
+		size_t begin = 0;
+		while(begin <= str.size()) {
+			size_t end = str.find(',', begin);
+			if(end == std::string::npos) {
+				end = str.size();
+			}
+			std::vector<Event> events;
+			if(not parse_group(str.substr(begin, end - begin), events)) {
+				_error = "unknown counter group '" + str.substr(begin, end - begin) + "'";
+				close();
+				return false;
+			}
+			open_group(events);
+			begin = end + 1u;
+		}
+		return available();
+	}
+
+	void close() noexcept {
+		for(auto& group : _groups) {
+			for(const int fd : group.fds) {
+				::close(fd);
+			}
+		}
+		_groups.clear();
+	}
+
+	bool available() const noexcept {
+		return not _groups.empty();
+	}
+
+	/**
+	 * @return Why some events are not available.
+	 */
+	const std::string& error() const noexcept {
+		return _error;
+	}
+
+	std::vector<Event> events() const {
+		std::vector<Event> result;
+		for(const auto& group : _groups) {
+			result.insert(result.end(), group.events.begin(), group.events.end());
+		}
+		return result;
+	}
+
+	void start() noexcept {
+		for(const auto& group : _groups) {
+			ioctl(group.leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+			ioctl(group.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		}
+	}
+
+	void stop(Sample& sample) noexcept {
+		for(const auto& group : _groups) {
+			ioctl(group.leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+		}
+		sample = Sample();
+		for(const auto& group : _groups) {
+			read_group(group, sample);
+		}
+	}
+
+	static const char* to_string(Event event) noexcept {
+		switch(event) {
+			case Event::Cycles:
+				return "cycles";
+			case Event::Instructions:
+				return "instructions";
+			case Event::BranchMisses:
+				return "branch-misses";
+			case Event::L1dMisses:
+				return "l1d-misses";
+			case Event::LlcMisses:
+				return "llc-misses";
+			case Event::DtlbMisses:
+				return "dtlb-misses";
+			case Event::TaskClock:
+				return "task-clock";
+			case Event::PageFaults:
+				return "page-faults";
+			default:
+				return "unknown";
+		}
+	}
+
+private:
+
+	static bool parse_group(const std::string& name, std::vector<Event>& events) {
+		if(name == "basic") {
+			events = {Event::Cycles, Event::Instructions, Event::BranchMisses};
+		} else if(name == "branch") {
+			events = {Event::Instructions, Event::BranchMisses};
+		} else if(name == "cache") {
+			events = {Event::Cycles, Event::L1dMisses, Event::LlcMisses};
+		} else if(name == "tlb") {
+			events = {Event::Cycles, Event::DtlbMisses};
+		} else if(name == "sw") {
+			events = {Event::TaskClock, Event::PageFaults};
+		} else {
+			size_t begin = 0;
+			while(begin <= name.size()) {
+				size_t end = name.find('+', begin);
+				if(end == std::string::npos) {
+					end = name.size();
+				}
+				const std::string event_name = name.substr(begin, end - begin);
+				size_t i = 0;
+				while(i < EVENT_COUNT && event_name != to_string(Event(i))) {
+					i++;
+				}
+				if(i == EVENT_COUNT) {
+					return false;
+				}
+				events.push_back(Event(i));
+				begin = end + 1u;
+			}
+		}
+		return true;
+	}
+
+	static void attributes(Event event, perf_event_attr& attr) noexcept {
+		static constexpr uint64_t CACHE_READ_MISS =
+			(PERF_COUNT_HW_CACHE_OP_READ << 8u) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16u);
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		switch(event) {
+			case Event::Cycles:
+				attr.config = PERF_COUNT_HW_CPU_CYCLES;
+				break;
+			case Event::Instructions:
+				attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+				break;
+			case Event::BranchMisses:
+				attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+				break;
+			case Event::L1dMisses:
+				attr.type = PERF_TYPE_HW_CACHE;
+				attr.config = PERF_COUNT_HW_CACHE_L1D | CACHE_READ_MISS;
+				break;
+			case Event::LlcMisses:
+				attr.config = PERF_COUNT_HW_CACHE_MISSES;
+				break;
+			case Event::DtlbMisses:
+				attr.type = PERF_TYPE_HW_CACHE;
+				attr.config = PERF_COUNT_HW_CACHE_DTLB | CACHE_READ_MISS;
+				break;
+			case Event::TaskClock:
+				attr.type = PERF_TYPE_SOFTWARE;
+				attr.config = PERF_COUNT_SW_TASK_CLOCK;
+				break;
+			case Event::PageFaults:
+				attr.type = PERF_TYPE_SOFTWARE;
+				attr.config = PERF_COUNT_SW_PAGE_FAULTS;
+				break;
+			default:
+				break;
+		}
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	}
+
+	void open_group(const std::vector<Event>& events) {
+		Group group;
+		for(const auto event : events) {
+			if(group.fds.size() == EVENT_COUNT) {
+				break;
+			}
+			perf_event_attr attr;
+			attributes(event, attr);
+			if(group.leader >= 0) {
+				attr.disabled = 0;
+			}
+			const int fd = int(syscall(SYS_perf_event_open, &attr, 0, -1, group.leader, 0));
+			if(fd < 0) {
+				_error.append(to_string(event));
+				_error.append(" : ");
+				_error.append(strerror(errno));
+				_error.append("; ");
+				continue;
+			}
+			if(group.leader < 0) {
+				group.leader = fd;
+			}
+			group.fds.push_back(fd);
+			group.events.push_back(event);
+		}
+		if(group.leader >= 0) {
+			_groups.push_back(std::move(group));
+		}
+	}
+
+	static void read_group(const Group& group, Sample& sample) noexcept {
+		// nr, time_enabled, time_running, values[nr]
+		uint64_t buffer[3u + EVENT_COUNT];
+		const size_t len = (3u + group.fds.size()) * sizeof(uint64_t);
+		if(read(group.leader, buffer, len) != ssize_t(len) || buffer[2] == 0) {
+			return;
+		}
+		const double scale = double(buffer[1]) / double(buffer[2]);
+		for(size_t i = 0; i < group.events.size() && i < buffer[0]; ++i) {
+			const size_t event = size_t(group.events[i]);
+			// The same event in several groups, the first one wins.
+			if(not sample.valid[event]) {
+				sample.value[event] = uint64_t(double(buffer[3u + i]) * scale);
+				sample.valid[event] = true;
+			}
+		}
+	}
+
+};
+
+}; // namespace utils
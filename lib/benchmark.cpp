@@ -0,0 +1,648 @@
+#include <cstdio>
+
+#include <lib/jjson/jjson.h>
+#include <lib/jjson/HugePageAllocator.h>
+#include <lib/Tsc.h>
+#include <lib/CorpusGenerator.h>
+#include <lib/PerfCounters.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace jjson;
+using utils::CorpusGenerator;
+using utils::PerfCounters;
+using utils::Tsc;
+
+struct NullReceiver {
+	void document_start() noexcept {}
+	bool document_stop() noexcept { return true; }
+	void document_failure() noexcept {}
+	void sax_event(SaxParserEvent, const std::string_view) noexcept {}
+};
+
+struct Options {
+	std::vector<CorpusGenerator::Shape> shapes;
+	std::vector<CorpusGenerator::Layout> layouts;
+	size_t min_size = 1024u;
+	size_t max_size = 16u * 1024u * 1024u;
+	size_t factor = 4u;
+	uint64_t seed = 1u;
+	double min_time = 0.1;
+	const char* plot_stage = "sax";
+	const char* csv = nullptr;
+	const char* counters = nullptr;
+	bool huge_pages = false;
+	bool latency = false;
+	int numa_node = HugePageAllocator<Node>::ANY_NODE;
+	FieldMask mask;
+};
+
+struct Measurement {
+	double seconds = 0;
+	Tsc::Counter cycles = 0;
+	PerfCounters::Sample counters;
+	bool ok = false;
+};
+
+/**
+ * Derived metrics printed when the hardware counters are enabled.
+ */
+struct CounterColumn {
+	const char* name;
+	double (*get)(const PerfCounters::Sample& sample, size_t size);
+};
+
+static const CounterColumn COUNTER_COLUMNS[] = {
+	{"IPC", [](const PerfCounters::Sample& sample, size_t) { return sample.ipc(); }},
+	{"brmiss/KB", [](const PerfCounters::Sample& sample, size_t size) { return sample.per_kb(PerfCounters::Event::BranchMisses, size); }},
+	{"L1dmiss/KB", [](const PerfCounters::Sample& sample, size_t size) { return sample.per_kb(PerfCounters::Event::L1dMisses, size); }},
+	{"LLCmiss/KB", [](const PerfCounters::Sample& sample, size_t size) { return sample.per_kb(PerfCounters::Event::LlcMisses, size); }},
+	{"dTLBmiss/KB", [](const PerfCounters::Sample& sample, size_t size) { return sample.per_kb(PerfCounters::Event::DtlbMisses, size); }},
+	{"faults/MB", [](const PerfCounters::Sample& sample, size_t size) { return sample.per_kb(PerfCounters::Event::PageFaults, size) * 1024.0; }},
+};
+
+static PerfCounters perf_counters;
+
+struct Result {
+	CorpusGenerator::Shape shape;
+	CorpusGenerator::Layout layout;
+	size_t target;
+	size_t size;
+	const char* stage;
+	Measurement best;
+
+	double mb_per_second() const noexcept {
+		return double(size) / (1024.0 * 1024.0) / best.seconds;
+	}
+
+	double cycles_per_byte() const noexcept {
+		return double(best.cycles) / double(size);
+	}
+};
+
+/**
+ * Runs the stage until min_time is spent, at least twice so the first touch of the memory
+ * is not the only sample, and keeps the fastest run.
+ */
+template <typename F>
+Measurement measure(F&& stage, double min_time) {
+	using Clock = std::chrono::steady_clock;
+	Measurement best;
+	double total = 0;
+	PerfCounters::Sample counters;
+	size_t runs = 0;
+	do {
+		const auto start = Clock::now();
+		perf_counters.start();
+		const auto start_tsc = Tsc::read();
+		const bool ok = stage();
+		const auto cycles = Tsc::read() - start_tsc;
+		perf_counters.stop(counters);
+		const std::chrono::duration<double> elapsed = Clock::now() - start;
+		total += elapsed.count();
+		if(not best.ok || elapsed.count() < best.seconds) {
+			best.seconds = elapsed.count();
+			best.cycles = cycles;
+			best.counters = counters;
+			best.ok = ok;
+		}
+		if(not ok) {
+			break;
+		}
+		runs++;
+	} while(total < min_time || runs < 2u);
+	return best;
+}
+
+size_t count_tokens(const PaddedInput& input) noexcept {
+	Tokenizer<> tkz;
+	tkz.reset(input);
+	size_t result = 0;
+	while(tkz.token_read()) {
+		result++;
+	}
+	return result;
+}
+
+void print_counter(double value) {
+	if(value < 0) {
+		printf(" %11s", "-");
+	} else {
+		printf(" %11.3f", value);
+	}
+}
+
+void run(const Options& options, CorpusGenerator::Shape shape, CorpusGenerator::Layout layout,
+		size_t size, std::vector<Result>& results) {
+	CorpusGenerator generator(shape, layout, options.seed);
+	const PaddedBuffer buffer(generator.generate(size));
+	const PaddedInput input = buffer.input();
+	const size_t tokens = count_tokens(input);
+
+	NullReceiver null_receiver;
+	SaxParser<NullReceiver> sax_parser(null_receiver);
+	DomBuilder<> dom(tokens + 1u);
+	SaxParser<DomBuilder<>> dom_parser(dom);
+	size_t checksum = 0;
+
+	const auto report = [&](const char* stage, const Measurement& best, size_t bytes = 0) {
+		results.push_back({shape, layout, size, bytes ? bytes : input.size(), stage, best});
+		const auto& result = results.back();
+		printf("%-9s %-9s %12zu %-9s %10.1f %8.2f",
+			CorpusGenerator::to_string(shape), CorpusGenerator::to_string(layout), result.size, stage,
+			result.mb_per_second(), result.cycles_per_byte());
+		if(perf_counters.available()) {
+			for(const auto& column : COUNTER_COLUMNS) {
+				print_counter(column.get(best.counters, result.size));
+			}
+		}
+		printf("%s\n", best.ok ? "" : "  FAILED");
+		fflush(stdout);
+	};
+
+	report("tokenize", measure([&]() {
+		checksum += count_tokens(input);
+		return true;
+	}, options.min_time));
+
+	report("sax", measure([&]() {
+		return sax_parser.parse(input);
+	}, options.min_time));
+
+	// The minified JSON back from the events, a call per event against a batch per 256 events.
+	SaxStringBuilder echo;
+	SaxParser<SaxStringBuilder> echo_parser(echo);
+	report("sax-echo", measure([&]() {
+		const bool ok = echo_parser.parse(input);
+		checksum += echo.output().size();
+		return ok;
+	}, options.min_time));
+
+	SaxBatcher<SaxStringBuilder> batcher(echo);
+	SaxParser<SaxBatcher<SaxStringBuilder>> batch_parser(batcher);
+	report("sax-batch", measure([&]() {
+		const bool ok = batch_parser.parse(input);
+		checksum += echo.output().size();
+		return ok;
+	}, options.min_time));
+
+	// The echo through a redact, a rename and a drop of the record fields, against 'sax-echo'.
+	SaxRedact<SaxStringBuilder> redact(echo);
+	redact.add("id");
+	SaxRename<SaxRedact<SaxStringBuilder>> rename(redact);
+	rename.add("name", "title");
+	SaxDrop<SaxRename<SaxRedact<SaxStringBuilder>>> drop(rename);
+	drop.add("tags");
+	SaxParser<SaxDrop<SaxRename<SaxRedact<SaxStringBuilder>>>> transform_parser(drop);
+	report("transform", measure([&]() {
+		const bool ok = transform_parser.parse(input);
+		checksum += echo.output().size();
+		return ok;
+	}, options.min_time));
+
+	// Accept or reject only, the full grammar with no events.
+	Validator<> validator;
+	report("validate", measure([&]() {
+		return validator.validate(input);
+	}, options.min_time));
+
+	// The dedup key of the document, no DOM.
+	SaxCanonicalHash canonical_hash;
+	SaxParser<SaxCanonicalHash> hash_parser(canonical_hash);
+	report("hash", measure([&]() {
+		const bool ok = hash_parser.parse(input);
+		checksum += canonical_hash.hash();
+		return ok;
+	}, options.min_time));
+
+	report("dom", measure([&]() {
+		const bool ok = dom_parser.parse(input);
+		checksum += dom.size();
+		return ok;
+	}, options.min_time));
+
+	// The key interning, the table is warm after the first run as with the documents of one schema.
+	KeyTable keys;
+	dom.set_key_table(&keys);
+	report("dom-keys", measure([&]() {
+		const bool ok = dom_parser.parse(input);
+		checksum += dom.size();
+		return ok;
+	}, options.min_time));
+	dom.set_key_table(nullptr);
+
+	// The children laid out adjacently for Node::at().
+	dom.set_contiguous(true);
+	report("dom-flat", measure([&]() {
+		const bool ok = dom_parser.parse(input);
+		checksum += dom.size();
+		return ok;
+	}, options.min_time));
+	dom.set_contiguous(false);
+
+	if(not options.mask.empty()) {
+		dom_parser.set_mask(&options.mask);
+		report("dom-mask", measure([&]() {
+			const bool ok = dom_parser.parse(input);
+			checksum += dom.size();
+			return ok;
+		}, options.min_time));
+		dom_parser.set_mask(nullptr);
+	}
+
+	// The serialization of a parsed DOM: a copy of the bytes against the iovecs referencing the input.
+	if(dom_parser.parse(input)) {
+		report("to-string", measure([&]() {
+			std::string output;
+			const bool ok = DomJsonStringBuilder::to_json_string(dom.root(), output);
+			checksum += output.size();
+			return ok;
+		}, options.min_time));
+
+		DomIovecBuilder iovecs;
+		report("iovec", measure([&]() {
+			const bool ok = iovecs.build(dom.root(), input.view());
+			checksum += iovecs.iovecs().size();
+			return ok;
+		}, options.min_time));
+		printf("%-9s %-9s %12s iovecs %zu side %zu B\n", "", "", "", iovecs.iovecs().size(), iovecs.side_size());
+	}
+
+	if(shape == CorpusGenerator::Shape::Records) {
+		ColumnarBuilder columnar;
+		SaxParser<ColumnarBuilder> columnar_parser(columnar);
+		report("columnar", measure([&]() {
+			const bool ok = columnar_parser.parse(input);
+			checksum += columnar.rows();
+			return ok;
+		}, options.min_time));
+	}
+
+	if(shape == CorpusGenerator::Shape::Records && layout == CorpusGenerator::Layout::Minified) {
+		// The records as NDJSON, about one in eight has "active":false and "parent":null.
+		std::string lines;
+		if(dom_parser.parse(input)) {
+			for(const Node* record : children(dom.root())) {
+				if(DomJsonStringBuilder::to_json_string(record, lines)) {
+					lines.push_back('\n');
+				}
+			}
+		}
+		const PaddedBuffer ndjson(lines);
+		RecordFilter<> filter;
+		filter.add("active", "false");
+		filter.add("parent", "null");
+		const auto filter_lines = [&]() {
+			const char* line = ndjson.input().data();
+			const char* end = line + ndjson.input().size();
+			while(line < end) {
+				const auto eol = static_cast<const char*>(memchr(line, '\n', end - line));
+				const size_t len = eol ? size_t(eol - line) : size_t(end - line);
+				checksum += filter.match(PaddedInput::assume_padded(line, len));
+				line += len + 1u;
+			}
+			return true;
+		};
+
+		filter.set_prefilter(false);
+		report("filter", measure(filter_lines, options.min_time), ndjson.input().size());
+		filter.set_prefilter(true);
+		filter.reset_statistics();
+		report("prefilter", measure(filter_lines, options.min_time), ndjson.input().size());
+		// Every run tests all the records, the shares do not depend on the number of the runs.
+		const auto& prefilter = filter.prefilter();
+		printf("%-9s %-9s %12s passed %.2f%% matched %.2f%%\n", "", "", "", 100.0 * prefilter.selectivity(),
+			prefilter.records() ? 100.0 * double(filter.matched()) / double(prefilter.records()) : 0.0);
+	}
+
+	if(options.huge_pages) {
+		using HugeDomBuilder = DomBuilder<HugePageAllocator<Node> >;
+		HugeDomBuilder huge_dom(tokens + 1u, HugePageAllocator<Node>(options.numa_node));
+		SaxParser<HugeDomBuilder> huge_parser(huge_dom);
+		report("dom-huge", measure([&]() {
+			const bool ok = huge_parser.parse(input);
+			checksum += huge_dom.size();
+			return ok;
+		}, options.min_time));
+	}
+
+	if(checksum == 0) {
+		printf("empty input\n");
+	}
+}
+
+/**
+ * The latency of a parse of a small document: a parser built per message, a context of the pool per message,
+ * a warm context parsing in place. Every parse is timed alone, the percentiles are in ns.
+ */
+void latency(const Options& options) {
+	static constexpr size_t SIZES[] = {64u, 256u, 1024u, 4096u};
+	static constexpr size_t MAX_SAMPLES = 1000000u;
+
+	// The TSC rate for the conversion to ns.
+	const auto clock_start = std::chrono::steady_clock::now();
+	const auto tsc_start = Tsc::read();
+	while(std::chrono::steady_clock::now() - clock_start < std::chrono::milliseconds(50)) {}
+	const std::chrono::duration<double> calibration = std::chrono::steady_clock::now() - clock_start;
+	const double ns_per_cycle = calibration.count() * 1e9 / double(Tsc::read() - tsc_start);
+
+	std::vector<Tsc::Counter> samples;
+	samples.reserve(MAX_SAMPLES);
+	const auto sample = [&](auto&& parse) {
+		samples.clear();
+		size_t checksum = 0;
+		const auto start = std::chrono::steady_clock::now();
+		do {
+			for(size_t i = 0; i < 1000u; ++i) {
+				const auto start_tsc = Tsc::read();
+				checksum += parse();
+				samples.push_back(Tsc::read() - start_tsc);
+			}
+		} while(samples.size() < MAX_SAMPLES && std::chrono::steady_clock::now() - start < std::chrono::duration<double>(options.min_time));
+		std::sort(samples.begin(), samples.end());
+		const auto percentile = [&](double p) {
+			return double(samples[size_t(p * double(samples.size() - 1u))]) * ns_per_cycle;
+		};
+		printf(" %10.0f %10.0f %10.0f %10zu%s\n", percentile(0.5), percentile(0.99), percentile(0.999),
+			samples.size(), checksum ? "" : "  FAILED");
+	};
+
+	printf("%-9s %-9s %8s %-9s %10s %10s %10s %10s\n", "shape", "layout", "size", "mode", "p50 ns", "p99 ns", "p999 ns", "samples");
+	for(const auto shape : options.shapes) {
+		for(const auto layout : options.layouts) {
+			for(const size_t target : SIZES) {
+				CorpusGenerator generator(shape, layout, options.seed);
+				const std::string text = generator.generate(target);
+				const PaddedBuffer buffer(text);
+				const size_t tokens = count_tokens(buffer.input());
+				const auto row = [&](const char* mode) {
+					printf("%-9s %-9s %8zu %-9s", CorpusGenerator::to_string(shape), CorpusGenerator::to_string(layout),
+						text.size(), mode);
+				};
+
+				row("fresh");
+				sample([&]() {
+					DomBuilder<> dom(tokens + 1u);
+					SaxParser<DomBuilder<>> parser(dom);
+					return parser.parse(std::string_view(text)) ? dom.size() : 0;
+				});
+
+				row("context");
+				sample([&]() {
+					auto context = ParseContext::acquire();
+					return context->parse(std::string_view(text)) ? context->dom().size() : 0;
+				});
+
+				auto context = ParseContext::acquire();
+				row("in-place");
+				sample([&]() {
+					return context->parse(buffer.input()) ? context->dom().size() : 0;
+				});
+			}
+		}
+	}
+}
+
+void plot_bar(const char* label, double value, double max_value) {
+	static constexpr int WIDTH = 50;
+	const int len = max_value > 0 ? int(value / max_value * WIDTH + 0.5) : 0;
+	printf("  %-28s %10.1f |%.*s\n", label, value, len,
+		"##################################################");
+}
+
+/**
+ * Throughput of the plot_stage against the size for every shape and against the shape for the largest size.
+ */
+void plot(const Options& options, const std::vector<Result>& results) {
+	double max_value = 0;
+	size_t max_target = 0;
+	for(const auto& result : results) {
+		if(strcmp(result.stage, options.plot_stage) == 0) {
+			max_value = std::max(max_value, result.mb_per_second());
+			max_target = std::max(max_target, result.target);
+		}
+	}
+
+	char label[64];
+	printf("\nThroughput against size, stage '%s', MB/s\n", options.plot_stage);
+	for(const auto shape : options.shapes) {
+		for(const auto layout : options.layouts) {
+			printf("%s %s\n", CorpusGenerator::to_string(shape), CorpusGenerator::to_string(layout));
+			for(const auto& result : results) {
+				if(result.shape == shape && result.layout == layout && strcmp(result.stage, options.plot_stage) == 0) {
+					snprintf(label, sizeof(label), "%zu", result.size);
+					plot_bar(label, result.mb_per_second(), max_value);
+				}
+			}
+		}
+	}
+
+	printf("\nThroughput against shape, stage '%s', the largest size, MB/s\n", options.plot_stage);
+	for(const auto& result : results) {
+		if(strcmp(result.stage, options.plot_stage) == 0 && result.target == max_target) {
+			snprintf(label, sizeof(label), "%s %s", CorpusGenerator::to_string(result.shape), CorpusGenerator::to_string(result.layout));
+			plot_bar(label, result.mb_per_second(), max_value);
+		}
+	}
+}
+
+bool write_csv(const char* file_name, const std::vector<Result>& results) {
+	auto file = fopen(file_name, "w");
+	if(not file) {
+		return false;
+	}
+	fprintf(file, "shape,layout,size,stage,mb_per_second,cycles_per_byte");
+	for(size_t i = 0; i < PerfCounters::EVENT_COUNT; ++i) {
+		fprintf(file, ",%s", PerfCounters::to_string(PerfCounters::Event(i)));
+	}
+	fprintf(file, "\n");
+	for(const auto& result : results) {
+		fprintf(file, "%s,%s,%zu,%s,%.3f,%.4f",
+			CorpusGenerator::to_string(result.shape), CorpusGenerator::to_string(result.layout),
+			result.size, result.stage, result.mb_per_second(), result.cycles_per_byte());
+		for(size_t i = 0; i < PerfCounters::EVENT_COUNT; ++i) {
+			const auto event = PerfCounters::Event(i);
+			if(result.best.counters.has(event)) {
+				fprintf(file, ",%lu", static_cast<unsigned long>(result.best.counters.get(event)));
+			} else {
+				fprintf(file, ",");
+			}
+		}
+		fprintf(file, "\n");
+	}
+	fclose(file);
+	return true;
+}
+
+/**
+ * Parses sizes like 512, 64K, 16M, 4G.
+ */
+size_t parse_size(const char* str) noexcept {
+	char* end = nullptr;
+	size_t result = strtoull(str, &end, 10);
+	switch(end ? *end : 0) {
+		case 'k':
+		case 'K':
+			result <<= 10u;
+			break;
+		case 'm':
+		case 'M':
+			result <<= 20u;
+			break;
+		case 'g':
+		case 'G':
+			result <<= 30u;
+			break;
+		default:
+			break;
+	}
+	return result;
+}
+
+template <typename T>
+bool parse_list(char* str, std::vector<T>& list) {
+	list.clear();
+	for(char* name = strtok(str, ","); name; name = strtok(nullptr, ",")) {
+		T value;
+		if(not CorpusGenerator::from_string(name, value)) {
+			fprintf(stderr, "unknown name '%s'\n", name);
+			return false;
+		}
+		list.push_back(value);
+	}
+	return not list.empty();
+}
+
+void usage() {
+	fprintf(stderr, "usage :\n");
+	fprintf(stderr, "\tbenchmark [options]\n");
+	fprintf(stderr, "\t\t--shapes records,deep,wide,strings,escaped,integers,floats\n");
+	fprintf(stderr, "\t\t--layouts minified,pretty\n");
+	fprintf(stderr, "\t\t--min-size 1K --max-size 16M --factor 4\n");
+	fprintf(stderr, "\t\t--seed 1 --min-time 0.1\n");
+	fprintf(stderr, "\t\t--plot tokenize|sax|sax-echo|sax-batch|transform|validate|hash|dom|dom-keys|dom-flat|dom-mask|to-string|iovec|columnar|filter|prefilter|dom-huge\n");
+	fprintf(stderr, "\t\t--csv file-name\n");
+	fprintf(stderr, "\t\t--counters basic,cache,tlb,sw or event+event,... see utils::PerfCounters\n");
+	fprintf(stderr, "\t\t--mask path,path,... : the 'dom-mask' stage, e.g. id,name,tags see jjson::FieldMask\n");
+	fprintf(stderr, "\t\t--huge-pages : the 'dom-huge' stage, the node pool on 2 MiB pages\n");
+	fprintf(stderr, "\t\t--numa-node N : the node of the 'dom-huge' pool\n");
+	fprintf(stderr, "\t\t--latency : p50/p99/p999 of a parse of 64 B - 4 KB documents instead of the throughput\n");
+	fprintf(stderr, "\tbenchmark --generate shape layout size file-name\n");
+	fprintf(stderr, "\tJJSON_KERNELS=scalar|sse42|avx2|avx512|neon forces the kernels, see jjson::CpuFeatures\n");
+}
+
+int generate(char** argv, uint64_t seed) {
+	CorpusGenerator::Shape shape;
+	CorpusGenerator::Layout layout;
+	if(not CorpusGenerator::from_string(argv[0], shape) || not CorpusGenerator::from_string(argv[1], layout)) {
+		usage();
+		return EXIT_FAILURE;
+	}
+	auto file = fopen(argv[3], "w");
+	if(not file) {
+		fprintf(stderr, "File '%s' is not available for writing.\n", argv[3]);
+		return EXIT_FAILURE;
+	}
+	CorpusGenerator generator(shape, layout, seed);
+	const bool result = generator.generate(parse_size(argv[2]), file);
+	fclose(file);
+	return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char** argv) {
+	Options options;
+	for(uint8_t i = 0; i < uint8_t(CorpusGenerator::Shape::Count); ++i) {
+		options.shapes.push_back(CorpusGenerator::Shape(i));
+	}
+	options.layouts = {CorpusGenerator::Layout::Minified, CorpusGenerator::Layout::Pretty};
+
+	for(int arg = 1; arg < argc; ++arg) {
+		const char* name = argv[arg];
+		const bool has_value = arg + 1 < argc;
+		if(strcmp(name, "--generate") == 0 && arg + 4 < argc) {
+			return generate(argv + arg + 1, options.seed);
+		} else if(strcmp(name, "--shapes") == 0 && has_value) {
+			if(not parse_list(argv[++arg], options.shapes)) {
+				return EXIT_FAILURE;
+			}
+		} else if(strcmp(name, "--layouts") == 0 && has_value) {
+			if(not parse_list(argv[++arg], options.layouts)) {
+				return EXIT_FAILURE;
+			}
+		} else if(strcmp(name, "--min-size") == 0 && has_value) {
+			options.min_size = parse_size(argv[++arg]);
+		} else if(strcmp(name, "--max-size") == 0 && has_value) {
+			options.max_size = parse_size(argv[++arg]);
+		} else if(strcmp(name, "--factor") == 0 && has_value) {
+			options.factor = std::max<size_t>(2u, strtoull(argv[++arg], nullptr, 10));
+		} else if(strcmp(name, "--seed") == 0 && has_value) {
+			options.seed = strtoull(argv[++arg], nullptr, 10);
+		} else if(strcmp(name, "--min-time") == 0 && has_value) {
+			options.min_time = atof(argv[++arg]);
+		} else if(strcmp(name, "--plot") == 0 && has_value) {
+			options.plot_stage = argv[++arg];
+		} else if(strcmp(name, "--csv") == 0 && has_value) {
+			options.csv = argv[++arg];
+		} else if(strcmp(name, "--counters") == 0 && has_value) {
+			options.counters = argv[++arg];
+		} else if(strcmp(name, "--mask") == 0 && has_value) {
+			const std::string_view paths(argv[++arg]);
+			for(size_t begin = 0; begin <= paths.size();) {
+				const size_t end = std::min(paths.find(',', begin), paths.size());
+				options.mask.add(paths.substr(begin, end - begin));
+				begin = end + 1u;
+			}
+		} else if(strcmp(name, "--latency") == 0) {
+			options.latency = true;
+		} else if(strcmp(name, "--huge-pages") == 0) {
+			options.huge_pages = true;
+		} else if(strcmp(name, "--numa-node") == 0 && has_value) {
+			options.numa_node = atoi(argv[++arg]);
+		} else {
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if(options.counters) {
+		if(not perf_counters.open(options.counters)) {
+			fprintf(stderr, "The counters are not available, %s\n", perf_counters.error().c_str());
+		} else if(not perf_counters.error().empty()) {
+			fprintf(stderr, "Some of the counters are not available, %s\n", perf_counters.error().c_str());
+		}
+	}
+
+	printf("kernels: %s\n", CpuFeatures::to_string(Kernels::get().tier));
+	if(options.latency) {
+		latency(options);
+		return EXIT_SUCCESS;
+	}
+
+	std::vector<Result> results;
+	printf("%-9s %-9s %12s %-9s %10s %8s", "shape", "layout", "size", "stage", "MB/s", "cyc/B");
+	if(perf_counters.available()) {
+		for(const auto& column : COUNTER_COLUMNS) {
+			printf(" %11s", column.name);
+		}
+	}
+	printf("\n");
+	for(const auto shape : options.shapes) {
+		for(const auto layout : options.layouts) {
+			for(size_t size = options.min_size; size <= options.max_size; size *= options.factor) {
+				run(options, shape, layout, size, results);
+			}
+		}
+	}
+
+	plot(options, results);
+
+	if(options.csv && not write_csv(options.csv, results)) {
+		fprintf(stderr, "File '%s' is not available for writing.\n", options.csv);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
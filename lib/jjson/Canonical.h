@@ -0,0 +1,506 @@
+#pragma once
+
+#include <lib/jjson/type.h>
+#include <lib/jjson/SaxParser.h>
+#include <lib/jjson/Escape.h>
+#include <lib/jjson/Hash.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace jjson {
+
+/**
+ * The normal forms of RFC 8785, JSON Canonicalization Scheme, shared by SaxCanonicalHash and SaxCanonicalWriter.
+ * The strings are compared and hashed decoded, see Escape::unescape(), the numbers as IEEE 754 doubles.
+ */
+class Canonical {
+
+public:
+
+	/** The longest number of write_number(). */
+	static constexpr size_t MAX_NUMBER = 32u;
+
+	/**
+	 * Reads a number token, -0 is 0.
+	 * @return false if the token is not a number or its magnitude does not fit a double.
+	 */
+	static bool number(std::string_view token, double& value) noexcept {
+		// The integers of 15 digits are exact, the most of the tokens take no from_chars().
+		const bool negative = not token.empty() && token[0] == '-';
+		const std::string_view digits = token.substr(negative ? 1u : 0u);
+		if(not digits.empty() && digits.size() <= 15u && (digits[0] != '0' || digits.size() == 1u)) {
+			int64_t integer = 0;
+			size_t i = 0;
+			for(; i < digits.size() && uint8_t(digits[i] - '0') < 10u; ++i) {
+				integer = integer * 10 + (digits[i] - '0');
+			}
+			if(i == digits.size()) {
+				value = double(negative ? -integer : integer);
+				value += 0.0;
+				return true;
+			}
+		}
+		const auto result = std::from_chars(token.data(), token.data() + token.size(), value);
+		if(result.ec != std::errc() || result.ptr != token.data() + token.size()) {
+			return false;
+		}
+		value += 0.0;
+		return true;
+	}
+
+	/**
+	 * Writes a finite double as ECMAScript Number.prototype.toString() does:
+	 * the shortest digits which read back to the value, the exponent form below 1e-6 and from 1e21.
+	 * @return The end of the written bytes, at most MAX_NUMBER.
+	 */
+	static char* write_number(char* out, double value) noexcept {
+		if(value == 0.0) {
+			*out++ = '0';
+			return out;
+		}
+		if(value < 0.0) {
+			*out++ = '-';
+			value = -value;
+		}
+		// d.ddde+XX, the shortest form with one digit before the point.
+		char scientific[MAX_NUMBER];
+		const auto result = std::to_chars(scientific, scientific + MAX_NUMBER, value, std::chars_format::scientific);
+		char digits[MAX_NUMBER];
+		int count = 0;
+		const char* p = scientific;
+		for(; *p != 'e'; ++p) {
+			if(*p != '.') {
+				digits[count++] = *p;
+			}
+		}
+		int exponent = 0;
+		std::from_chars(p + (p[1] == '+' ? 2 : 1), result.ptr, exponent);
+		// The value is 0.digits * 10^point.
+		const int point = exponent + 1;
+
+		if(count <= point && point <= 21) {
+			out = copy(out, digits, count);
+			memset(out, '0', point - count);
+			return out + (point - count);
+		}
+		if(0 < point && point <= 21) {
+			out = copy(out, digits, point);
+			*out++ = '.';
+			return copy(out, digits + point, count - point);
+		}
+		if(-6 < point && point <= 0) {
+			*out++ = '0';
+			*out++ = '.';
+			memset(out, '0', -point);
+			out += -point;
+			return copy(out, digits, count);
+		}
+		*out++ = digits[0];
+		if(count > 1) {
+			*out++ = '.';
+			out = copy(out, digits + 1, count - 1);
+		}
+		*out++ = 'e';
+		*out++ = exponent < 0 ? '-' : '+';
+		const auto written = std::to_chars(out, out + 4, exponent < 0 ? -exponent : exponent);
+		return written.ptr;
+	}
+
+	/**
+	 * Orders the decoded keys by their UTF-16 code units, as RFC 8785 sorts the object members.
+	 * The UTF-8 byte order differs only for U+E000..U+FFFF against the supplementary planes.
+	 */
+	static bool key_less(std::string_view lhs, std::string_view rhs) noexcept {
+		const size_t size = std::min(lhs.size(), rhs.size());
+		size_t i = 0;
+		while(i < size && lhs[i] == rhs[i]) {
+			i++;
+		}
+		if(i == size) {
+			return lhs.size() < rhs.size();
+		}
+		// The code points which differ start at the same offset of both keys.
+		while(i > 0 && (uint8_t(lhs[i]) & 0xC0u) == 0x80u) {
+			i--;
+		}
+		return utf16_order(lhs.substr(i)) < utf16_order(rhs.substr(i));
+	}
+
+private:
+
+	static char* copy(char* out, const char* data, int size) noexcept {
+		memcpy(out, data, size);
+		return out + size;
+	}
+
+	/**
+	 * The code point at the start of the text as the ordered pair of its UTF-16 code units.
+	 */
+	static uint32_t utf16_order(std::string_view text) noexcept {
+		const auto c = uint8_t(text[0]);
+		uint32_t code;
+		if(c < 0x80u) {
+			return uint32_t(c) << 10u;
+		} else if(c < 0xE0u) {
+			code = c & 0x1Fu;
+		} else if(c < 0xF0u) {
+			code = c & 0x0Fu;
+		} else {
+			code = c & 0x07u;
+		}
+		const size_t len = c < 0xE0u ? 2u : (c < 0xF0u ? 3u : 4u);
+		for(size_t i = 1u; i < len && i < text.size(); ++i) {
+			code = (code << 6u) | (uint8_t(text[i]) & 0x3Fu);
+		}
+		if(code < 0x10000u) {
+			return code << 10u;
+		}
+		code -= 0x10000u;
+		return ((0xD800u + (code >> 10u)) << 10u) | (code & 0x3FFu);
+	}
+
+};
+
+/**
+ * The SAX receiver which hashes a document to 64 bits in one pass, the equal documents hash equal:
+ * - the whitespace does not matter, the strings and the keys are hashed decoded;
+ * - the numbers are hashed as doubles: 1, 1.0 and 1e0 are equal, see Canonical::number();
+ * - the members of an object are hashed in any order, their hashes are added up;
+ * - the elements of an array are hashed in order.
+ * Every value mixes its type in, "1" and 1 differ. The hash is not cryptographic, see Hash.
+ *
+ * SaxParser<SaxCanonicalHash> parser(hash);
+ * if(parser.parse(input)) { hash.hash(); }
+ */
+class SaxCanonicalHash {
+
+	static constexpr uint64_t NULL_SEED = 0x6E756C6C6E756C6Cull;
+	static constexpr uint64_t FALSE_SEED = 0x66616C736566616Cull;
+	static constexpr uint64_t TRUE_SEED = 0x7472756574727565ull;
+	static constexpr uint64_t NUMBER_SEED = 0x6E756D6265726E75ull;
+	static constexpr uint64_t STRING_SEED = 0x737472696E677374ull;
+	static constexpr uint64_t ARRAY_SEED = 0x6172726179617272ull;
+	static constexpr uint64_t OBJECT_SEED = 0x6F626A6563746F62ull;
+
+	/**
+	 * An open container: the ordered hash of an array, the sum of the member hashes of an object.
+	 */
+	struct Frame {
+		uint64_t hash;
+		uint64_t key;
+		uint64_t count;
+		bool is_object;
+	};
+
+	std::vector<Frame> _stack;
+	std::string _decoded;
+	uint64_t _hash;
+	bool _valid;
+
+public:
+
+	SaxCanonicalHash() noexcept : _hash(0), _valid(false) {}
+
+	/**
+	 * @return The hash of the last document, valid if its parse() has succeeded.
+	 */
+	uint64_t hash() const noexcept {
+		return _hash;
+	}
+
+	void document_start() noexcept {
+		_stack.resize(0);
+		_hash = 0;
+		_valid = true;
+	}
+
+	/**
+	 * @return false if a string has an invalid escape sequence.
+	 */
+	bool document_stop() noexcept {
+		return _valid;
+	}
+
+	void document_failure() noexcept {
+		_valid = false;
+	}
+
+	void sax_event(const SaxParserEvent event, const std::string_view data) {
+		switch(event) {
+			case SaxParserEvent::ObjectStart:
+				_stack.push_back(Frame{0, 0, 0, true});
+				break;
+
+			case SaxParserEvent::ArrayStart:
+				_stack.push_back(Frame{ARRAY_SEED, 0, 0, false});
+				break;
+
+			case SaxParserEvent::ObjectStop:
+			case SaxParserEvent::ArrayStop: {
+				const Frame frame = _stack.back();
+				_stack.pop_back();
+				const uint64_t seed = frame.is_object ? OBJECT_SEED : ARRAY_SEED;
+				value(Hash::combine(Hash::combine(seed, frame.count), frame.hash));
+				break;
+			}
+
+			case SaxParserEvent::ObjectItemStart:
+				_stack.back().key = string(data);
+				break;
+
+			case SaxParserEvent::String:
+				value(string(data));
+				break;
+
+			case SaxParserEvent::Number: {
+				double number;
+				if(Canonical::number(data, number)) {
+					uint64_t bits;
+					memcpy(&bits, &number, sizeof(bits));
+					value(Hash::combine(NUMBER_SEED, bits));
+				} else {
+					// Out of the double range, the text is the only form.
+					value(Hash::hash64(data.data(), data.size(), NUMBER_SEED));
+				}
+				break;
+			}
+
+			case SaxParserEvent::Null:
+				value(Hash::avalanche(NULL_SEED));
+				break;
+
+			case SaxParserEvent::Bool:
+				value(Hash::avalanche(data[0] == 't' ? TRUE_SEED : FALSE_SEED));
+				break;
+
+			case SaxParserEvent::ObjectItemStop:
+			case SaxParserEvent::ValueSeparator:
+				break;
+		}
+	}
+
+private:
+
+	/**
+	 * @param data - the token with the quotes.
+	 */
+	uint64_t string(std::string_view data) {
+		std::string_view content = data.substr(1u, data.size() - 2u);
+		if(content.find('\\') != std::string_view::npos) {
+			_decoded.resize(0);
+			if(not Escape::unescape(_decoded, content)) {
+				_valid = false;
+			}
+			content = _decoded;
+		}
+		return Hash::hash64(content.data(), content.size(), STRING_SEED);
+	}
+
+	void value(uint64_t hash) noexcept {
+		if(_stack.empty()) {
+			_hash = hash;
+			return;
+		}
+		Frame& frame = _stack.back();
+		if(frame.is_object) {
+			frame.hash += Hash::combine(frame.key, hash);
+		} else {
+			frame.hash = Hash::combine(frame.hash, hash);
+		}
+		frame.count++;
+	}
+
+};
+
+/**
+ * The SAX receiver which writes a document in the canonical form of RFC 8785:
+ * no whitespace, the object members sorted by the UTF-16 code units of the decoded keys,
+ * the strings escaped minimally, the numbers as Canonical::write_number() writes them.
+ *
+ * The members of an open object are kept in the output and are put in order at its '}',
+ * a member nested N objects deep is moved N times.
+ *
+ * IMPORTANT:
+ * - The input is expected to be valid UTF-8 with the unique keys, see Validator: the duplicates are kept.
+ * - The document fails on a number out of the double range and on an invalid escape sequence.
+ */
+class SaxCanonicalWriter {
+
+	struct Member {
+		/** The decoded key in _keys. */
+		size_t key_begin;
+		size_t key_size;
+		/** "key":value in _output. */
+		size_t text_begin;
+		size_t text_end;
+	};
+
+	struct Frame {
+		size_t text_begin;
+		size_t first_member;
+		size_t keys_size;
+		bool is_object;
+		bool has_value;
+	};
+
+	std::string _output;
+	std::string _keys;
+	std::string _decoded;
+	std::string _sorted;
+	std::vector<Member> _members;
+	std::vector<Frame> _stack;
+	bool _valid;
+
+public:
+
+	SaxCanonicalWriter() noexcept : _valid(false) {}
+
+	const std::string& output() const noexcept {
+		return _output;
+	}
+
+	void document_start() noexcept {
+		_output.resize(0);
+		_keys.resize(0);
+		_members.resize(0);
+		_stack.resize(0);
+		_valid = true;
+	}
+
+	bool document_stop() noexcept {
+		return _valid;
+	}
+
+	void document_failure() noexcept {
+		_valid = false;
+	}
+
+	void sax_event(const SaxParserEvent event, const std::string_view data) {
+		switch(event) {
+			case SaxParserEvent::ObjectStart:
+				separator();
+				_stack.push_back(Frame{_output.size(), _members.size(), _keys.size(), true, false});
+				_output.push_back('{');
+				break;
+
+			case SaxParserEvent::ArrayStart:
+				separator();
+				_stack.push_back(Frame{_output.size(), _members.size(), _keys.size(), false, false});
+				_output.push_back('[');
+				break;
+
+			case SaxParserEvent::ObjectStop:
+				sort_members();
+				_stack.pop_back();
+				break;
+
+			case SaxParserEvent::ArrayStop:
+				_output.push_back(']');
+				_stack.pop_back();
+				break;
+
+			case SaxParserEvent::ObjectItemStart: {
+				const size_t key_begin = _keys.size();
+				if(not Escape::unescape(_keys, data.substr(1u, data.size() - 2u))) {
+					_valid = false;
+				}
+				const size_t text_begin = _output.size();
+				write_string(std::string_view(_keys).substr(key_begin));
+				_output.push_back(':');
+				_members.push_back(Member{key_begin, _keys.size() - key_begin, text_begin, 0});
+				break;
+			}
+
+			case SaxParserEvent::ObjectItemStop:
+				_members.back().text_end = _output.size();
+				break;
+
+			case SaxParserEvent::String:
+				separator();
+				_decoded.resize(0);
+				if(not Escape::unescape(_decoded, data.substr(1u, data.size() - 2u))) {
+					_valid = false;
+				}
+				write_string(_decoded);
+				break;
+
+			case SaxParserEvent::Number: {
+				separator();
+				double number;
+				if(not Canonical::number(data, number)) {
+					_valid = false;
+					break;
+				}
+				char buffer[Canonical::MAX_NUMBER];
+				_output.append(buffer, Canonical::write_number(buffer, number) - buffer);
+				break;
+			}
+
+			case SaxParserEvent::Null:
+			case SaxParserEvent::Bool:
+				separator();
+				_output.append(data);
+				break;
+
+			case SaxParserEvent::ValueSeparator:
+				break;
+		}
+	}
+
+private:
+
+	/**
+	 * The commas of an array are written as they come, the commas of an object at its end.
+	 */
+	void separator() {
+		if(not _stack.empty() && not _stack.back().is_object) {
+			if(_stack.back().has_value) {
+				_output.push_back(',');
+			}
+			_stack.back().has_value = true;
+		}
+	}
+
+	void write_string(std::string_view text) {
+		const size_t begin = _output.size();
+		_output.resize(begin + Escape::size(text) + 2u);
+		char* out = _output.data() + begin;
+		*out++ = '"';
+		out = Escape::write(out, text);
+		*out = '"';
+	}
+
+	/**
+	 * Rewrites the members of the innermost object in the key order and drops them from the stack.
+	 */
+	void sort_members() {
+		const Frame& frame = _stack.back();
+		const auto first = _members.begin() + frame.first_member;
+		const std::string_view keys = _keys;
+		std::stable_sort(first, _members.end(), [keys](const Member& lhs, const Member& rhs) {
+			return Canonical::key_less(keys.substr(lhs.key_begin, lhs.key_size), keys.substr(rhs.key_begin, rhs.key_size));
+		});
+		_sorted.resize(0);
+		_sorted.push_back('{');
+		for(auto member = first; member != _members.end(); ++member) {
+			if(member != first) {
+				_sorted.push_back(',');
+			}
+			_sorted.append(_output, member->text_begin, member->text_end - member->text_begin);
+		}
+		_sorted.push_back('}');
+		_output.resize(frame.text_begin);
+		_output.append(_sorted);
+		_members.erase(first, _members.end());
+		_keys.resize(frame.keys_size);
+	}
+
+};
+
+} // namespace jjson
@@ -0,0 +1,599 @@
+#pragma once
+
+#include <lib/jjson/type.h>
+#include <lib/jjson/SaxParser.h>
+#include <lib/jjson/KeyTable.h>
+
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace jjson {
+
+enum class ColumnType : char {
+	/** No value but null has been seen yet. */
+	Null,
+	Bool,
+	Int64,
+	Double,
+	/** The string content as in the input, the escapes are not decoded (same as Node::data). */
+	String,
+	/** The JSON text of the values, the objects, the arrays and the mixed types fall back to it. */
+	Json
+};
+
+/**
+ * A typed contiguous column, only the vectors of the type are used.
+ * The null and the missing values have the validity bit cleared and a zero value.
+ * The vectors may be moved out, e.g. to hand the column off without copying.
+ */
+class Column {
+
+	friend class ColumnarBuilder;
+
+	std::string _name;
+	ColumnType _type;
+	size_t _rows;
+	size_t _null_count;
+
+public:
+
+	/** A bit per row, 1 - the value is valid. */
+	std::vector<uint64_t> validity;
+	std::vector<uint8_t> bools;
+	std::vector<int64_t> int64s;
+	std::vector<double> doubles;
+	/** String and Json, the value of the row i is [offsets[i], offsets[i + 1]) of bytes. */
+	std::vector<uint64_t> offsets;
+	std::string bytes;
+
+	Column(std::string_view name, size_t null_rows) :
+		_name(name), _type(ColumnType::Null), _rows(0), _null_count(0) {
+		for(size_t i = 0; i < null_rows; ++i) {
+			append_null();
+		}
+	}
+
+	const std::string& name() const noexcept {
+		return _name;
+	}
+
+	ColumnType type() const noexcept {
+		return _type;
+	}
+
+	size_t size() const noexcept {
+		return _rows;
+	}
+
+	size_t null_count() const noexcept {
+		return _null_count;
+	}
+
+	bool is_valid(size_t row) const noexcept {
+		return (validity[row / 64u] >> (row % 64u)) & 1u;
+	}
+
+	std::string_view string(size_t row) const noexcept {
+		return std::string_view(bytes.data() + offsets[row], offsets[row + 1u] - offsets[row]);
+	}
+
+	static const char* to_string(ColumnType type) noexcept {
+		switch(type) {
+			case ColumnType::Null:
+				return "null";
+			case ColumnType::Bool:
+				return "bool";
+			case ColumnType::Int64:
+				return "int64";
+			case ColumnType::Double:
+				return "double";
+			case ColumnType::String:
+				return "string";
+			case ColumnType::Json:
+				return "json";
+		}
+		return "unknown";
+	}
+
+private:
+
+	/**
+	 * Makes an empty column keeping the capacity of the vectors.
+	 */
+	void recycle(std::string_view name, size_t null_rows) {
+		_name = name;
+		_type = ColumnType::Null;
+		_rows = 0;
+		_null_count = 0;
+		validity.clear();
+		bools.clear();
+		int64s.clear();
+		doubles.clear();
+		offsets.clear();
+		bytes.clear();
+		for(size_t i = 0; i < null_rows; ++i) {
+			append_null();
+		}
+	}
+
+	void append_valid(bool valid) {
+		if(_rows % 64u == 0) {
+			validity.push_back(0);
+		}
+		validity.back() |= uint64_t(valid) << (_rows % 64u);
+		_null_count += not valid;
+		_rows++;
+	}
+
+	void append_null() {
+		switch(_type) {
+			case ColumnType::Null:
+				break;
+			case ColumnType::Bool:
+				bools.push_back(0);
+				break;
+			case ColumnType::Int64:
+				int64s.push_back(0);
+				break;
+			case ColumnType::Double:
+				doubles.push_back(0);
+				break;
+			case ColumnType::String:
+			case ColumnType::Json:
+				offsets.push_back(bytes.size());
+				break;
+		}
+		append_valid(false);
+	}
+
+	/**
+	 * The null column takes the type, the zero values are stored for the rows so far.
+	 */
+	void adopt(ColumnType type) {
+		_type = type;
+		switch(type) {
+			case ColumnType::Null:
+				break;
+			case ColumnType::Bool:
+				bools.assign(_rows, 0);
+				break;
+			case ColumnType::Int64:
+				int64s.assign(_rows, 0);
+				break;
+			case ColumnType::Double:
+				doubles.assign(_rows, 0);
+				break;
+			case ColumnType::String:
+			case ColumnType::Json:
+				offsets.assign(_rows + 1u, 0);
+				break;
+		}
+	}
+
+	void widen_to_double() {
+		doubles.resize(int64s.size());
+		for(size_t i = 0; i < int64s.size(); ++i) {
+			doubles[i] = double(int64s[i]);
+		}
+		int64s = std::vector<int64_t>();
+		_type = ColumnType::Double;
+	}
+
+	/**
+	 * Converts the values so far to their JSON text.
+	 */
+	void widen_to_json() {
+		std::string json;
+		std::vector<uint64_t> json_offsets;
+		json_offsets.reserve(_rows + 1u);
+		json_offsets.push_back(0);
+		char buffer[32];
+		for(size_t row = 0; row < _rows; ++row) {
+			if(is_valid(row)) {
+				switch(_type) {
+					case ColumnType::Null:
+					case ColumnType::Json:
+						break;
+					case ColumnType::Bool:
+						json.append(bools[row] ? "true" : "false");
+						break;
+					case ColumnType::Int64:
+						json.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), int64s[row]).ptr);
+						break;
+					case ColumnType::Double:
+						json.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), doubles[row]).ptr);
+						break;
+					case ColumnType::String:
+						json.push_back('"');
+						json.append(string(row));
+						json.push_back('"');
+						break;
+				}
+			}
+			json_offsets.push_back(json.size());
+		}
+		bools = std::vector<uint8_t>();
+		int64s = std::vector<int64_t>();
+		doubles = std::vector<double>();
+		bytes.swap(json);
+		offsets.swap(json_offsets);
+		_type = ColumnType::Json;
+	}
+
+};
+
+/**
+ * Receiver of SaxParser, pivots an array of records [{...}, {...}, ...] to the typed columns
+ * without building the Node graph, see Column.
+ *
+ * A column is created by the first record with the field, the earlier rows are null.
+ * The type of a column is the type of its values: int64 is widened to double, the other
+ * mixed types, the objects and the arrays fall back to the JSON text.
+ * The first 'sample_records' records infer the schema, after that a new field or a type change
+ * is a schema drift: Drift::Widen handles it as above, Drift::Reject fails the document,
+ * e.g. to fall back to DomBuilder.
+ * The fields are expected in the order of the schema, a key lookup is needed only out of the order.
+ * The first of the duplicate keys of a record wins.
+ */
+class ColumnarBuilder {
+public:
+
+	enum class Drift : char {
+		Widen,
+		Reject
+	};
+
+private:
+
+	const size_t _sample_records;
+	const Drift _drift;
+	KeyTable _keys;
+	std::vector<size_t> _column_of_key;
+	std::vector<Column> _columns;
+	std::vector<Column> _recycled;
+	size_t _rows;
+	size_t _depth;
+	size_t _field;
+	Column* _column;
+	const char* _nested_begin;
+	std::string _error;
+
+	static constexpr size_t NO_COLUMN = SIZE_MAX;
+
+public:
+
+	ColumnarBuilder(const ColumnarBuilder&) = delete;
+	ColumnarBuilder& operator=(const ColumnarBuilder&) = delete;
+
+	ColumnarBuilder(ColumnarBuilder&& rv) = delete;
+	ColumnarBuilder& operator=(ColumnarBuilder&&) = delete;
+
+	explicit ColumnarBuilder(size_t sample_records = 64u, Drift drift = Drift::Widen) :
+		_sample_records(sample_records),
+		_drift(drift),
+		_rows(0),
+		_depth(0),
+		_field(0),
+		_column(nullptr),
+		_nested_begin(nullptr) {}
+
+	size_t rows() const noexcept {
+		return _rows;
+	}
+
+	const std::vector<Column>& columns() const noexcept {
+		return _columns;
+	}
+
+	/**
+	 * Moves the columns out, the builder is empty after it.
+	 */
+	std::vector<Column> release_columns() noexcept {
+		std::vector<Column> result;
+		result.swap(_columns);
+		reset();
+		_recycled.clear();
+		return result;
+	}
+
+	const Column* column(std::string_view name) const noexcept {
+		const uint32_t id = _keys.find(name);
+		if(id == Node::NO_KEY_ID || id >= _column_of_key.size() || _column_of_key[id] == NO_COLUMN) {
+			return nullptr;
+		}
+		return &_columns[_column_of_key[id]];
+	}
+
+	/**
+	 * @return The reason document_stop() has returned false.
+	 */
+	const std::string& error() const noexcept {
+		return _error;
+	}
+
+	/**
+	 * The storage of the columns is reused by the next document.
+	 */
+	void reset() noexcept {
+		_keys.clear();
+		_column_of_key.clear();
+		while(not _columns.empty()) {
+			_recycled.push_back(std::move(_columns.back()));
+			_columns.pop_back();
+		}
+		_rows = 0;
+		_depth = 0;
+		_field = 0;
+		_column = nullptr;
+		_nested_begin = nullptr;
+		_error.clear();
+	}
+
+	void document_start() noexcept {
+		reset();
+	}
+
+	bool document_stop() noexcept {
+		return _error.empty();
+	}
+
+	void document_failure() noexcept {}
+
+	void sax_event(SaxParserEvent event, const std::string_view data) {
+		if(not _error.empty()) {
+			return;
+		}
+
+		switch(event) {
+			case SaxParserEvent::ObjectStart :
+			case SaxParserEvent::ArrayStart :
+				if(_depth == 0) {
+					if(event != SaxParserEvent::ArrayStart) {
+						_error = "the document is not an array";
+					}
+				} else if(_depth == 1u) {
+					if(event != SaxParserEvent::ObjectStart) {
+						_error = "the element " + std::to_string(_rows) + " is not an object";
+					}
+					_field = 0;
+				} else if(_depth == 2u) {
+					_nested_begin = data.data();
+				}
+				_depth++;
+				break;
+
+			case SaxParserEvent::ObjectStop :
+			case SaxParserEvent::ArrayStop :
+				_depth--;
+				if(_depth == 2u) {
+					append_json(std::string_view(_nested_begin, data.data() + 1 - _nested_begin));
+				} else if(_depth == 1u) {
+					record_stop();
+				}
+				break;
+
+			case SaxParserEvent::ObjectItemStart :
+				if(_depth == 2u) {
+					select_column(data.substr(1, data.size() - 2u));
+				}
+				break;
+
+			case SaxParserEvent::String :
+				if(_depth == 2u) {
+					append_string(data.substr(1, data.size() - 2u));
+				} else if(_depth < 2u) {
+					_error = "the element " + std::to_string(_rows) + " is not an object";
+				}
+				break;
+
+			case SaxParserEvent::Number :
+				if(_depth == 2u) {
+					append_number(data);
+				} else if(_depth < 2u) {
+					_error = "the element " + std::to_string(_rows) + " is not an object";
+				}
+				break;
+
+			case SaxParserEvent::Bool :
+				if(_depth == 2u) {
+					append_bool(data[0] == 't');
+				} else if(_depth < 2u) {
+					_error = "the element " + std::to_string(_rows) + " is not an object";
+				}
+				break;
+
+			case SaxParserEvent::Null :
+				if(_depth < 2u) {
+					_error = "the element " + std::to_string(_rows) + " is not an object";
+				}
+				if(_depth == 2u) {
+					// The null is appended by record_stop().
+					_column = nullptr;
+				}
+				break;
+
+			case SaxParserEvent::ObjectItemStop :
+			case SaxParserEvent::ValueSeparator :
+				break;
+		}
+	}
+
+private:
+
+	bool is_sampling() const noexcept {
+		return _rows < _sample_records;
+	}
+
+	bool drift(const char* what, std::string_view name) {
+		if(_drift == Drift::Reject && not is_sampling()) {
+			_error = std::string("schema drift at the record ") + std::to_string(_rows) + " : " + what + " '";
+			_error.append(name);
+			_error.push_back('\'');
+			return false;
+		}
+		return true;
+	}
+
+	void select_column(std::string_view key) {
+		_column = nullptr;
+
+		// The fast path, the field is in the order of the schema.
+		size_t index = _field++;
+		if(index >= _columns.size() || _columns[index]._name != key) {
+			const uint32_t id = _keys.intern(key);
+			if(id == Node::NO_KEY_ID) {
+				_error = "too many fields";
+				return;
+			}
+			if(id >= _column_of_key.size()) {
+				_column_of_key.resize(id + 1u, NO_COLUMN);
+			}
+			index = _column_of_key[id];
+			if(index == NO_COLUMN) {
+				if(not drift("new field", key)) {
+					return;
+				}
+				index = _columns.size();
+				_column_of_key[id] = index;
+				if(_recycled.empty()) {
+					_columns.emplace_back(key, _rows);
+				} else {
+					_columns.push_back(std::move(_recycled.back()));
+					_recycled.pop_back();
+					_columns.back().recycle(key, _rows);
+				}
+			}
+		}
+
+		Column& column = _columns[index];
+		if(column._rows == _rows) {
+			_column = &column;
+		}
+	}
+
+	/**
+	 * @return The selected column if it can take the type.
+	 */
+	Column* column_for(ColumnType type) {
+		Column* column = _column;
+		_column = nullptr;
+		if(column == nullptr || column->_type == type || column->_type == ColumnType::Json) {
+			return column;
+		}
+		if(column->_type == ColumnType::Null) {
+			column->adopt(type);
+			return column;
+		}
+		// An integer is stored in a double column as it is, the column does not change.
+		if(column->_type == ColumnType::Double && type == ColumnType::Int64) {
+			return column;
+		}
+		if(not drift("type change of the field", column->_name)) {
+			return nullptr;
+		}
+		if(column->_type == ColumnType::Int64 && type == ColumnType::Double) {
+			column->widen_to_double();
+		} else {
+			column->widen_to_json();
+		}
+		return column;
+	}
+
+	void append_number(std::string_view data) {
+		int64_t value = 0;
+		const auto result = std::from_chars(data.data(), data.data() + data.size(), value);
+		if(result.ec == std::errc() && result.ptr == data.data() + data.size()) {
+			Column* column = column_for(ColumnType::Int64);
+			if(column == nullptr) {
+				return;
+			}
+			switch(column->_type) {
+				case ColumnType::Int64:
+					column->int64s.push_back(value);
+					break;
+				case ColumnType::Double:
+					column->doubles.push_back(double(value));
+					break;
+				default:
+					append_text(*column, data);
+					return;
+			}
+			column->append_valid(true);
+			return;
+		}
+
+		// A fraction or out of the int64 range.
+		Column* column = column_for(ColumnType::Double);
+		if(column == nullptr) {
+			return;
+		}
+		if(column->_type == ColumnType::Double) {
+			double number = 0;
+			std::from_chars(data.data(), data.data() + data.size(), number);
+			column->doubles.push_back(number);
+			column->append_valid(true);
+		} else {
+			append_text(*column, data);
+		}
+	}
+
+	void append_bool(bool value) {
+		Column* column = column_for(ColumnType::Bool);
+		if(column == nullptr) {
+			return;
+		}
+		if(column->_type == ColumnType::Bool) {
+			column->bools.push_back(value);
+			column->append_valid(true);
+		} else {
+			append_text(*column, value ? "true" : "false");
+		}
+	}
+
+	void append_string(std::string_view data) {
+		Column* column = column_for(ColumnType::String);
+		if(column == nullptr) {
+			return;
+		}
+		if(column->_type == ColumnType::String) {
+			append_text(*column, data);
+		} else {
+			column->bytes.push_back('"');
+			column->bytes.append(data);
+			column->bytes.push_back('"');
+			column->offsets.push_back(column->bytes.size());
+			column->append_valid(true);
+		}
+	}
+
+	void append_json(std::string_view data) {
+		Column* column = column_for(ColumnType::Json);
+		if(column) {
+			append_text(*column, data);
+		}
+	}
+
+	static void append_text(Column& column, std::string_view data) {
+		column.bytes.append(data);
+		column.offsets.push_back(column.bytes.size());
+		column.append_valid(true);
+	}
+
+	/**
+	 * The fields missing from the record are null.
+	 */
+	void record_stop() {
+		_rows++;
+		for(auto& column : _columns) {
+			if(column._rows < _rows) {
+				column.append_null();
+			}
+		}
+		_column = nullptr;
+	}
+
+};
+
+} // namespace jjson
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <string_view>
+
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+namespace jjson {
+
+/**
+ * The instruction set tiers of the scanning kernels, see Kernels.
+ * The x86 tiers are ordered, a tier needs the features of the lower ones.
+ */
+enum class CpuTier : uint8_t {
+	Scalar,
+	Sse42,
+	Avx2,
+	Avx512,
+	Neon
+};
+
+/**
+ * Detects the CPU features once: cpuid on x86, getauxval() on aarch64.
+ */
+class CpuFeatures {
+
+	static constexpr const char* ENVIRONMENT = "JJSON_KERNELS";
+
+public:
+
+	static const char* to_string(CpuTier tier) noexcept {
+		switch(tier) {
+			case CpuTier::Scalar:
+				return "scalar";
+			case CpuTier::Sse42:
+				return "sse42";
+			case CpuTier::Avx2:
+				return "avx2";
+			case CpuTier::Avx512:
+				return "avx512";
+			case CpuTier::Neon:
+				return "neon";
+			default:
+				return "unknown";
+		}
+	}
+
+	static bool from_string(std::string_view name, CpuTier& tier) noexcept {
+		for(const auto value : {CpuTier::Scalar, CpuTier::Sse42, CpuTier::Avx2, CpuTier::Avx512, CpuTier::Neon}) {
+			if(name == to_string(value)) {
+				tier = value;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * @return true if the CPU and the OS run the kernels of the tier.
+	 */
+	static bool supports(CpuTier tier) noexcept {
+		switch(tier) {
+			case CpuTier::Scalar:
+				return true;
+
+#if defined(__x86_64__) || defined(__i386__)
+			case CpuTier::Sse42:
+				__builtin_cpu_init();
+				return __builtin_cpu_supports("sse4.2");
+
+			case CpuTier::Avx2:
+				__builtin_cpu_init();
+				return __builtin_cpu_supports("avx2");
+
+			case CpuTier::Avx512:
+				__builtin_cpu_init();
+				return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#endif
+
+#if defined(__aarch64__)
+			case CpuTier::Neon:
+#if defined(__linux__)
+				return (getauxval(AT_HWCAP) & HWCAP_ASIMD) != 0;
+#else
+				// Advanced SIMD is a part of the base aarch64.
+				return true;
+#endif
+#endif
+
+			default:
+				return false;
+		}
+	}
+
+	/**
+	 * @return The highest tier the CPU supports.
+	 */
+	static CpuTier best() noexcept {
+		for(const auto tier : {CpuTier::Avx512, CpuTier::Avx2, CpuTier::Sse42, CpuTier::Neon}) {
+			if(supports(tier)) {
+				return tier;
+			}
+		}
+		return CpuTier::Scalar;
+	}
+
+	/**
+	 * @return best() or the tier forced by JJSON_KERNELS=scalar|sse42|avx2|avx512|neon.
+	 * A forced tier the CPU does not support falls to the highest supported tier below it,
+	 * an unknown name is ignored.
+	 */
+	static CpuTier select() noexcept {
+		const char* name = getenv(ENVIRONMENT);
+		CpuTier tier;
+		if(name == nullptr || not from_string(name, tier)) {
+			return best();
+		}
+		if(tier == CpuTier::Neon) {
+			return supports(tier) ? tier : CpuTier::Scalar;
+		}
+		while(tier != CpuTier::Scalar && not supports(tier)) {
+			tier = CpuTier(uint8_t(tier) - 1u);
+		}
+		return tier;
+	}
+
+};
+
+} // namespace jjson
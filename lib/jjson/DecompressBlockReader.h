@@ -0,0 +1,320 @@
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#if defined(JJSON_ZLIB)
+#include <zlib.h>
+#endif
+
+#if defined(JJSON_ZSTD)
+#include <zstd.h>
+#endif
+
+namespace jjson {
+
+/**
+ * Decompresses the blocks of another block reader, see PreadBlockReader for the interface.
+ *
+ * The format is detected by the magic bytes of the stream: gzip (also the concatenated members),
+ * zstd (also the concatenated frames) or plain, the plain blocks are passed through as is.
+ * Only one output block is held, so the memory does not depend on the inflated size.
+ * gzip requires JJSON_ZLIB and zstd requires JJSON_ZSTD, see CMakeLists.txt.
+ *
+ * @tparam R - the source block reader, e.g. FileBlockReader.
+ */
+template <typename R>
+class DecompressBlockReader {
+public:
+
+	enum class Format : char {
+		Plain,
+		Gzip,
+		Zstd
+	};
+
+private:
+
+	R _source;
+	const size_t _block_size;
+	std::unique_ptr<char[]> _output;
+	std::string_view _input;
+	Format _format;
+	bool _first;
+	bool _source_eof;
+	bool _complete;
+	std::string _error;
+
+#if defined(JJSON_ZLIB)
+	z_stream _zs;
+	bool _zs_ready;
+#endif
+
+#if defined(JJSON_ZSTD)
+	ZSTD_DCtx* _zstd;
+#endif
+
+public:
+
+	DecompressBlockReader(const DecompressBlockReader&) = delete;
+	DecompressBlockReader& operator=(const DecompressBlockReader&) = delete;
+
+	DecompressBlockReader(DecompressBlockReader&& rv) = delete;
+	DecompressBlockReader& operator=(DecompressBlockReader&&) = delete;
+
+	/**
+	 * @param block_size - the size of the decompressed blocks.
+	 * @param args - the arguments of the source reader constructor.
+	 */
+	template <typename... Args>
+	explicit DecompressBlockReader(size_t block_size, Args&&... args) :
+		_source(std::forward<Args>(args)...),
+		_block_size(block_size),
+		_output(new char[block_size]),
+		_format(Format::Plain),
+		_first(false),
+		_source_eof(true),
+		_complete(true) {
+#if defined(JJSON_ZLIB)
+		memset(&_zs, 0, sizeof(_zs));
+		_zs_ready = false;
+#endif
+#if defined(JJSON_ZSTD)
+		_zstd = nullptr;
+#endif
+	}
+
+	~DecompressBlockReader() noexcept {
+		close();
+#if defined(JJSON_ZLIB)
+		if(_zs_ready) {
+			inflateEnd(&_zs);
+		}
+#endif
+#if defined(JJSON_ZSTD)
+		ZSTD_freeDCtx(_zstd);
+#endif
+	}
+
+	bool open(const char* file_name) {
+		close();
+		_error.clear();
+		if(not _source.open(file_name)) {
+			_error = _source.error();
+			return false;
+		}
+
+		_input = std::string_view();
+		_source_eof = not _source.next(_input);
+		_first = true;
+		_complete = true;
+		_format = detect(_input);
+		return start();
+	}
+
+	void close() noexcept {
+		_source.close();
+		_input = std::string_view();
+		_source_eof = true;
+	}
+
+	bool next(std::string_view& block) {
+		if(not _error.empty()) {
+			return false;
+		}
+		switch(_format) {
+			case Format::Plain:
+				return next_plain(block);
+
+			case Format::Gzip:
+			case Format::Zstd:
+				break;
+		}
+
+		size_t len = 0;
+		while(len < _block_size) {
+			if(_input.empty() && not read_input()) {
+				break;
+			}
+			if(not decompress(len)) {
+				return false;
+			}
+		}
+
+		if(_source_eof && _input.empty() && not _complete && _error.empty()) {
+			_error = std::string(to_string(_format)) + " : unexpected end of the stream";
+		}
+		if(len == 0) {
+			return false;
+		}
+		block = std::string_view(_output.get(), len);
+		return true;
+	}
+
+	bool failed() const noexcept {
+		return not _error.empty();
+	}
+
+	const std::string& error() const noexcept {
+		return _error;
+	}
+
+	Format format() const noexcept {
+		return _format;
+	}
+
+	/**
+	 * @return true if the blocks of the source are passed through, see ThreadedBlockReader.
+	 */
+	bool is_plain() const noexcept {
+		return _format == Format::Plain;
+	}
+
+	R& source() noexcept {
+		return _source;
+	}
+
+	static const char* to_string(Format format) noexcept {
+		switch(format) {
+			case Format::Plain:
+				return "plain";
+			case Format::Gzip:
+				return "gzip";
+			case Format::Zstd:
+				return "zstd";
+		}
+		return "unknown";
+	}
+
+	static Format detect(std::string_view block) noexcept {
+		if(block.size() >= 2u && block[0] == '\x1F' && block[1] == '\x8B') {
+			return Format::Gzip;
+		}
+		if(block.size() >= 4u && memcmp(block.data(), "\x28\xB5\x2F\xFD", 4u) == 0) {
+			return Format::Zstd;
+		}
+		return Format::Plain;
+	}
+
+private:
+
+	bool next_plain(std::string_view& block) {
+		if(_first) {
+			_first = false;
+			if(not _input.empty()) {
+				block = _input;
+				return true;
+			}
+		}
+		if(_source_eof || not _source.next(block)) {
+			_source_eof = true;
+			_error = _source.error();
+			return false;
+		}
+		return true;
+	}
+
+	bool read_input() {
+		if(_source_eof || not _source.next(_input)) {
+			_source_eof = true;
+			_input = std::string_view();
+			if(_source.failed()) {
+				_error = _source.error();
+			}
+			return false;
+		}
+		return true;
+	}
+
+	bool start() {
+		switch(_format) {
+			case Format::Plain:
+				return true;
+
+			case Format::Gzip:
+#if defined(JJSON_ZLIB)
+				if(_zs_ready) {
+					inflateReset(&_zs);
+				} else {
+					// 15 + 32 : the largest window, detect the gzip or zlib header.
+					_zs_ready = inflateInit2(&_zs, 15 + 32) == Z_OK;
+				}
+				if(_zs_ready) {
+					return true;
+				}
+				_error = "gzip : inflateInit2() has failed";
+#else
+				_error = "gzip : not supported, build with JJSON_ZLIB";
+#endif
+				return false;
+
+			case Format::Zstd:
+#if defined(JJSON_ZSTD)
+				if(_zstd == nullptr) {
+					_zstd = ZSTD_createDCtx();
+				}
+				if(_zstd && not ZSTD_isError(ZSTD_DCtx_reset(_zstd, ZSTD_reset_session_only))) {
+					return true;
+				}
+				_error = "zstd : ZSTD_createDCtx() has failed";
+#else
+				_error = "zstd : not supported, build with JJSON_ZSTD";
+#endif
+				return false;
+		}
+		return false;
+	}
+
+	/**
+	 * Decompresses a part of the input to the output buffer at 'len'.
+	 */
+	bool decompress(size_t& len) {
+#if defined(JJSON_ZLIB)
+		if(_format == Format::Gzip) {
+			if(_complete) {
+				// The next member of a concatenated stream.
+				inflateReset(&_zs);
+			}
+			_zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(_input.data()));
+			_zs.avail_in = uInt(_input.size());
+			_zs.next_out = reinterpret_cast<Bytef*>(_output.get() + len);
+			_zs.avail_out = uInt(_block_size - len);
+			const int result = inflate(&_zs, Z_NO_FLUSH);
+			_input.remove_prefix(_input.size() - _zs.avail_in);
+			len = _block_size - _zs.avail_out;
+			if(result == Z_STREAM_END) {
+				_complete = true;
+			} else if(result == Z_OK || result == Z_BUF_ERROR) {
+				_complete = false;
+			} else {
+				_error = std::string("gzip : ") + (_zs.msg ? _zs.msg : "inflate() has failed");
+				return false;
+			}
+			return true;
+		}
+#endif
+#if defined(JJSON_ZSTD)
+		if(_format == Format::Zstd) {
+			ZSTD_inBuffer in = { _input.data(), _input.size(), 0 };
+			ZSTD_outBuffer out = { _output.get(), _block_size, len };
+			const size_t result = ZSTD_decompressStream(_zstd, &out, &in);
+			if(ZSTD_isError(result)) {
+				_error = std::string("zstd : ") + ZSTD_getErrorName(result);
+				return false;
+			}
+			_input.remove_prefix(in.pos);
+			len = out.pos;
+			_complete = result == 0;
+			return true;
+		}
+#endif
+		(void)len;
+		return false;
+	}
+
+};
+
+} // namespace jjson
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <lib/jjson/PaddedInput.h>
+
+#include <cstring>
+#include <string_view>
+
+namespace jjson {
+
+/**
+ * Cuts the blocks of a block reader into the documents for SaxParser.
+ *
+ * Mode::Whole - the stream is a single document.
+ * Mode::Lines - newline delimited documents (NDJSON), the blank lines are skipped.
+ *   A raw new line can not appear inside a JSON document, so the split is exact and
+ *   only the current document plus one block are buffered.
+ *
+ * The documents are padded and NUL terminated, see PaddedInput, they stay valid until the next call.
+ * The padding of a line is the rest of the buffer, the next lines, it is not zeroed: zeroing it
+ * would take a copy of every line and no reader depends on the bytes of the padding.
+ *
+ * @tparam R - block reader, see PreadBlockReader.
+ */
+template <typename R>
+class DocumentSplitter {
+public:
+
+	enum class Mode : char {
+		Whole,
+		Lines
+	};
+
+private:
+
+	R& _reader;
+	const Mode _mode;
+	PaddedBuffer _buffer;
+	size_t _begin;
+	size_t _scan;
+	size_t _bytes_read;
+	bool _eof;
+
+public:
+
+	DocumentSplitter(R& reader, Mode mode = Mode::Whole) noexcept :
+		_reader(reader), _mode(mode), _begin(0), _scan(0), _bytes_read(0), _eof(false) {}
+
+	/**
+	 * Call it after the reader has been (re)opened.
+	 */
+	void reset() noexcept {
+		_buffer.clear();
+		_begin = 0;
+		_scan = 0;
+		_bytes_read = 0;
+		_eof = false;
+	}
+
+	/**
+	 * @return false at the end of the stream, check failed() of the reader.
+	 */
+	bool next(PaddedInput& document) {
+		return _mode == Mode::Lines ? next_line(document) : next_whole(document);
+	}
+
+	bool next(std::string_view& document) {
+		PaddedInput input;
+		const bool result = next(input);
+		document = input.view();
+		return result;
+	}
+
+	size_t bytes_read() const noexcept {
+		return _bytes_read;
+	}
+
+private:
+
+	bool next_whole(PaddedInput& document) {
+		if(_eof) {
+			return false;
+		}
+		_buffer.clear();
+		while(read_block()) {}
+		document = _buffer.input();
+		return not is_blank(document.view());
+	}
+
+	bool next_line(PaddedInput& document) {
+		for(;;) {
+			const auto found = _scan < _buffer.size() ?
+				static_cast<char*>(memchr(_buffer.data() + _scan, '\n', _buffer.size() - _scan)) : nullptr;
+			if(found) {
+				const size_t end = found - _buffer.data();
+				// The rest of the buffer is the padding of the line.
+				*found = 0;
+				document = PaddedInput::assume_padded(_buffer.data() + _begin, end - _begin);
+				_begin = end + 1u;
+				_scan = _begin;
+				if(is_blank(document.view())) {
+					continue;
+				}
+				return true;
+			}
+
+			_scan = _buffer.size();
+			if(_eof) {
+				if(_begin >= _buffer.size()) {
+					document = PaddedInput();
+					return false;
+				}
+				document = PaddedInput::assume_padded(_buffer.data() + _begin, _buffer.size() - _begin);
+				_begin = _buffer.size();
+				return not is_blank(document.view());
+			}
+
+			// Drop the consumed documents and append the next block to the incomplete one.
+			_buffer.erase_front(_begin);
+			_scan -= _begin;
+			_begin = 0;
+			read_block();
+		}
+	}
+
+	bool read_block() {
+		std::string_view block;
+		if(_reader.next(block)) {
+			_buffer.append(block);
+			_bytes_read += block.size();
+			return true;
+		}
+		_eof = true;
+		return false;
+	}
+
+	static bool is_blank(std::string_view str) noexcept {
+		for(const char c : str) {
+			switch(c) {
+				case ' ':
+				case '\t':
+				case '\r':
+				case '\n':
+				case 0:
+					break;
+				default:
+					return false;
+			}
+		}
+		return true;
+	}
+
+};
+
+} // namespace jjson
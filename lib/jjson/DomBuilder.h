@@ -2,23 +2,54 @@
 
 #include <lib/jjson/type.h>
 #include <lib/jjson/SaxParser.h>
+#include <lib/jjson/KeyTable.h>
+#include <lib/jjson/StringArena.h>
 
 #include <cstdio>
 #include <string>
 #include <vector>
 #include <memory>
+#include <utility>
 
 namespace jjson {
 
+/**
+ * @tparam A - allocator of the node pool and the builder stack, see jjson::pmr::DomBuilder.
+ */
 template<typename A = std::allocator<Node> >
 class DomBuilder {
 
-	const size_t _capacity;
+	using StackAllocator = typename std::allocator_traits<A>::template rebind_alloc<Node*>;
+	using CharAllocator = typename std::allocator_traits<A>::template rebind_alloc<char>;
+
+	/** Frees a new pool if the next allocation throws, see set_capacity(). */
+	struct PoolGuard {
+		A& allocator;
+		Node* pool;
+		size_t capacity;
+
+		~PoolGuard() noexcept {
+			if(pool) {
+				allocator.deallocate(pool, capacity);
+			}
+		}
+
+		Node* release() noexcept {
+			return std::exchange(pool, nullptr);
+		}
+	};
+
+	size_t _capacity;
 	A _allocator;
 	Node* _value_pool;
+	Node* _layout_pool;
 	size_t _used_value;
-	std::vector<Node*> _stack;
+	Node* _free;
+	std::vector<Node*, StackAllocator> _stack;
+	BasicStringArena<CharAllocator> _strings;
 	Node* _root;
+	KeyTable* _keys;
+	bool _contiguous;
 	bool _is_allocation_reject;
 
 public:
@@ -29,28 +60,140 @@ public:
 	DomBuilder(DomBuilder&& rv) = delete;
 	DomBuilder& operator=(DomBuilder&&) = delete;
 
-	DomBuilder(size_t value_pool_capacity) noexcept :
+	DomBuilder(size_t value_pool_capacity, const A& allocator = A()) noexcept :
 		_capacity(value_pool_capacity),
+		_allocator(allocator),
 		_value_pool(_allocator.allocate(value_pool_capacity)),
+		_layout_pool(nullptr),
 		_used_value(0),
+		_free(nullptr),
+		_stack(StackAllocator(_allocator)),
+		_strings(CharAllocator(_allocator)),
 		_root(nullptr),
+		_keys(nullptr),
+		_contiguous(false),
 		_is_allocation_reject(false) {}
 
 	~DomBuilder() noexcept {
 		_allocator.deallocate(_value_pool, _capacity);
 		_value_pool = nullptr;
+		if(_layout_pool) {
+			_allocator.deallocate(_layout_pool, _capacity);
+			_layout_pool = nullptr;
+		}
 	}
 
 	const Node* root() const noexcept {
 		return _root;
 	}
 
+	/**
+	 * The root for the edits, see DomEditor.
+	 */
+	Node* mutable_root() noexcept {
+		return _root;
+	}
+
+	/**
+	 * @return How many nodes of the pool are in use, the nodes are stored contiguously from root().
+	 */
+	size_t size() const noexcept {
+		return _used_value;
+	}
+
+	size_t capacity() const noexcept {
+		return _capacity;
+	}
+
+	/**
+	 * Replaces the node pool with a pool of 'capacity' nodes, the document is dropped.
+	 * The settings and the other buffers are kept, the builder is unchanged if the allocation throws.
+	 */
+	void set_capacity(size_t capacity) {
+		if(capacity == _capacity) {
+			return;
+		}
+		PoolGuard pool{_allocator, _allocator.allocate(capacity), capacity};
+		Node* layout_pool = _layout_pool ? _allocator.allocate(capacity) : nullptr;
+		if(_layout_pool) {
+			_allocator.deallocate(_layout_pool, _capacity);
+		}
+		_allocator.deallocate(_value_pool, _capacity);
+		_value_pool = pool.release();
+		_layout_pool = layout_pool;
+		_capacity = capacity;
+		reset();
+	}
+
+	/**
+	 * Enables the key interning, the Key nodes get the ids of the table in Node::key_id.
+	 * The table is not owned and may be shared by the documents with the same schema, nullptr disables it.
+	 */
+	void set_key_table(KeyTable* keys) noexcept {
+		_keys = keys;
+	}
+
+	KeyTable* key_table() const noexcept {
+		return _keys;
+	}
+
+	/**
+	 * Lays the children of every container out adjacently when the document is built,
+	 * so Node::at() is O(1). It costs a copy of the nodes and a second pool of the same capacity,
+	 * the pool is allocated here, so document_stop() does not allocate, and freed by set_contiguous(false).
+	 */
+	void set_contiguous(bool contiguous) {
+		if(contiguous && _layout_pool == nullptr) {
+			_layout_pool = _allocator.allocate(_capacity);
+		} else if(not contiguous && _layout_pool) {
+			_allocator.deallocate(_layout_pool, _capacity);
+			_layout_pool = nullptr;
+		}
+		_contiguous = contiguous;
+	}
+
 	bool is_allocation_reject() const noexcept {
 		return _is_allocation_reject;
 	}
 
+	/**
+	 * Takes a node from the free list or from the rest of the pool.
+	 * @return The node with no links or nullptr if the pool is exhausted.
+	 */
+	Node* new_node(const NodeType type, const std::string_view data) noexcept {
+		if(_free) {
+			Node* result = _free;
+			_free = _free->next;
+			init_value(result, type, data);
+			return result;
+		}
+		if(_used_value < _capacity) {
+			return alloc_value(type, data);
+		}
+		return nullptr;
+	}
+
+	/**
+	 * Returns the node to the free list, its value is not freed.
+	 */
+	void free_node(Node* node) noexcept {
+		node->type = NodeType::Unknown;
+		node->value = nullptr;
+		node->next = _free;
+		_free = node;
+	}
+
+	/**
+	 * The bytes of the strings of the edits, they live until reset().
+	 */
+	BasicStringArena<CharAllocator>& strings() noexcept {
+		return _strings;
+	}
+
 	void reset() noexcept {
 		_used_value = 0;
+		_free = nullptr;
+		_strings.clear();
 		_stack.resize(0);
 		_stack.push_back(nullptr);
 		_root = nullptr;
@@ -63,6 +206,9 @@ public:
 
 	bool document_stop() noexcept {
 		if(_used_value > 0) {
+			if(_contiguous && not _is_allocation_reject) {
+				relayout();
+			}
 			_root = _value_pool;
 		}
 		return not _is_allocation_reject;
@@ -110,6 +256,9 @@ public:
 
 			case SaxParserEvent::ObjectItemStart :
 				append_next_value(NodeType::Key, data.substr(1, data.size() - 2u));
+				if(_keys && not _is_allocation_reject) {
+					_stack.back()->key_id = _keys->intern(_stack.back()->data);
+				}
 				_stack.push_back(nullptr);
 				break;
 
@@ -148,16 +297,60 @@ private:
 			_stack.back()->next = new_val;
 			_stack.back() = new_val;
 		}
+
+		if(_stack.size() > 1u) {
+			auto parent = _stack[_stack.size() - 2u];
+			if(parent->type != NodeType::Key) {
+				parent->child_count++;
+			}
+		}
+	}
+
+	/**
+	 * Copies the nodes to the layout pool in the breadth-first order, the children of a node
+	 * are copied together, and swaps the pools.
+	 */
+	void relayout() noexcept {
+		Node* pool = _layout_pool;
+		pool[0] = _value_pool[0];
+		pool[0].next = nullptr;
+		size_t used = 1u;
+		for(size_t i = 0; i < used; ++i) {
+			Node& node = pool[i];
+			// The value still points to the old pool.
+			const Node* child = node.value;
+			if(child) {
+				node.value = pool + used;
+				for(; child; child = child->next) {
+					pool[used] = *child;
+					pool[used].next = child->next ? pool + used + 1u : nullptr;
+					used++;
+				}
+			}
+			if(node.is_container()) {
+				node.flags |= Node::CONTIGUOUS;
+			}
+		}
+		std::swap(_value_pool, _layout_pool);
 	}
 
 	Node* alloc_value(const NodeType type, const std::string_view data) noexcept {
 		Node* result = _value_pool + _used_value;
 		_used_value++;
+		init_value(result, type, data);
+		return result;
+	}
+
+	static void init_value(Node* result, const NodeType type, const std::string_view data) noexcept {
 		result->next = nullptr;
 		result->value = nullptr;
 		result->data = data;
+		result->key_id = Node::NO_KEY_ID;
+		if(type == NodeType::Object || type == NodeType::Array) {
+			result->child_count = 0;
+		}
 		result->type = type;
-		return result;
+		result->flags = 0;
 	}
 
 };
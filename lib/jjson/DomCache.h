@@ -0,0 +1,261 @@
+#pragma once
+
+#include <lib/jjson/type.h>
+#include <lib/jjson/Hash.h>
+#include <lib/jjson/SaxParser.h>
+#include <lib/jjson/DomBuilder.h>
+#include <lib/jjson/PaddedInput.h>
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace jjson {
+
+/**
+ * Bounded cache of parsed documents keyed by the content hash of the input bytes.
+ *
+ * A hit returns the same immutable document to every caller, the document owns a copy
+ * of the input and its node pool so it stays valid while anyone holds the pointer.
+ * Entries are evicted in LRU order once the sum of their byte sizes exceeds the budget.
+ * The cache is split into shards each protected by its own mutex, documents are parsed
+ * outside of the lock by a per-thread DomBuilder, it is resized to the node capacity of the cache in use.
+ * The allocations throw std::bad_alloc, the cache stays consistent then.
+ */
+class DomCache {
+public:
+
+	class Document {
+
+		friend class DomCache;
+
+		const uint64_t _hash;
+		const PaddedBuffer _input;
+		std::vector<Node> _nodes;
+
+	public:
+
+		Document(uint64_t hash, std::string_view input) : _hash(hash), _input(input) {}
+
+		const Node* root() const noexcept {
+			return _nodes.empty() ? nullptr : _nodes.data();
+		}
+
+		std::string_view input() const noexcept {
+			return _input.view();
+		}
+
+		uint64_t hash() const noexcept {
+			return _hash;
+		}
+
+		/**
+		 * @return How many bytes the document holds, used for the cache accounting.
+		 */
+		size_t byte_size() const noexcept {
+			return sizeof(Document) + _input.capacity() + PaddedInput::PADDING + _nodes.capacity() * sizeof(Node);
+		}
+
+	};
+
+	using DocumentPtr = std::shared_ptr<const Document>;
+
+private:
+
+	struct Shard {
+		std::mutex mutex;
+		std::list<DocumentPtr> lru;
+		std::unordered_map<uint64_t, std::list<DocumentPtr>::iterator> index;
+		size_t bytes = 0;
+	};
+
+	struct Parser {
+		DomBuilder<> dom;
+		SaxParser<DomBuilder<>> parser;
+
+		explicit Parser(size_t node_capacity) : dom(node_capacity), parser(dom) {}
+	};
+
+	const size_t _shard_capacity;
+	const size_t _node_capacity;
+	const uint64_t _seed;
+	std::vector<Shard> _shards;
+
+	std::atomic<size_t> _hits;
+	std::atomic<size_t> _misses;
+	std::atomic<size_t> _evictions;
+	std::atomic<size_t> _rejects;
+
+public:
+
+	DomCache(const DomCache&) = delete;
+	DomCache& operator=(const DomCache&) = delete;
+
+	DomCache(DomCache&& rv) = delete;
+	DomCache& operator=(DomCache&&) = delete;
+
+	/**
+	 * @param byte_capacity - the budget of all the cached documents in bytes.
+	 * @param node_capacity - the node pool capacity used to parse a single document.
+	 * @param shard_count - how many independently locked parts the cache is split to.
+	 */
+	DomCache(size_t byte_capacity, size_t node_capacity, size_t shard_count = 16u, uint64_t seed = 0) noexcept :
+		_shard_capacity(byte_capacity / (shard_count ? shard_count : 1u)),
+		_node_capacity(node_capacity),
+		_seed(seed),
+		_shards(shard_count ? shard_count : 1u),
+		_hits(0),
+		_misses(0),
+		_evictions(0),
+		_rejects(0) {}
+
+	~DomCache() noexcept = default;
+
+	/**
+	 * @return The parsed document or nullptr if the input is not a valid JSON document
+	 * or it does not fit the node pool.
+	 */
+	DocumentPtr parse(std::string_view input) {
+		const uint64_t hash = Hash::hash64(input.data(), input.size(), _seed);
+		Shard& shard = _shards[hash % _shards.size()];
+
+		{
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			auto it = shard.index.find(hash);
+			if(it != shard.index.end() && (*it->second)->input() == input) {
+				shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+				_hits.fetch_add(1u, std::memory_order_relaxed);
+				return *it->second;
+			}
+		}
+
+		_misses.fetch_add(1u, std::memory_order_relaxed);
+		auto document = build(hash, input);
+		if(not document) {
+			_rejects.fetch_add(1u, std::memory_order_relaxed);
+			return nullptr;
+		}
+		return insert(shard, std::move(document));
+	}
+
+	void clear() noexcept {
+		for(auto& shard : _shards) {
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			shard.index.clear();
+			shard.lru.clear();
+			shard.bytes = 0;
+		}
+	}
+
+	size_t hits() const noexcept {
+		return _hits.load(std::memory_order_relaxed);
+	}
+
+	size_t misses() const noexcept {
+		return _misses.load(std::memory_order_relaxed);
+	}
+
+	size_t evictions() const noexcept {
+		return _evictions.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * @return How many inputs have failed to parse.
+	 */
+	size_t rejects() const noexcept {
+		return _rejects.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * @return How many bytes are held by the cached documents.
+	 */
+	size_t byte_size() noexcept {
+		size_t result = 0;
+		for(auto& shard : _shards) {
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			result += shard.bytes;
+		}
+		return result;
+	}
+
+	size_t byte_capacity() const noexcept {
+		return _shard_capacity * _shards.size();
+	}
+
+private:
+
+	std::shared_ptr<Document> build(uint64_t hash, std::string_view input) {
+		// The pool of the thread is shared by the caches, its capacity is the limit of this one.
+		thread_local std::unique_ptr<Parser> local;
+		if(not local) {
+			local = std::make_unique<Parser>(_node_capacity);
+		} else {
+			local->dom.set_capacity(_node_capacity);
+		}
+
+		auto document = std::make_shared<Document>(hash, input);
+		if(not local->parser.parse(document->_input.input())) {
+			return nullptr;
+		}
+
+		// Relocate the nodes from the thread local pool to the document.
+		const Node* pool = local->dom.root();
+		const size_t size = local->dom.size();
+		document->_nodes.assign(pool, pool + size);
+		Node* nodes = document->_nodes.data();
+		for(size_t i = 0; i < size; ++i) {
+			if(nodes[i].next) {
+				nodes[i].next = nodes + (nodes[i].next - pool);
+			}
+			if(nodes[i].value) {
+				nodes[i].value = nodes + (nodes[i].value - pool);
+			}
+		}
+		return document;
+	}
+
+	DocumentPtr insert(Shard& shard, std::shared_ptr<Document> document) {
+		const size_t bytes = document->byte_size();
+		if(bytes > _shard_capacity) {
+			return document;
+		}
+
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		auto it = shard.index.find(document->hash());
+		if(it != shard.index.end()) {
+			if((*it->second)->input() == document->input()) {
+				// Another thread has cached the same input meanwhile.
+				shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+				return *it->second;
+			}
+			// Hash collision, the newer document takes the slot.
+			erase(shard, it->second);
+		}
+
+		while(shard.bytes + bytes > _shard_capacity && not shard.lru.empty()) {
+			erase(shard, std::prev(shard.lru.end()));
+			_evictions.fetch_add(1u, std::memory_order_relaxed);
+		}
+
+		// The entry is allocated before it is linked, a throw leaves the shard consistent.
+		std::list<DocumentPtr> entry(1u, document);
+		auto& slot = shard.index[document->hash()];
+		shard.lru.splice(shard.lru.begin(), entry);
+		slot = shard.lru.begin();
+		shard.bytes += bytes;
+		return document;
+	}
+
+	static void erase(Shard& shard, std::list<DocumentPtr>::iterator it) noexcept {
+		shard.bytes -= (*it)->byte_size();
+		shard.index.erase((*it)->hash());
+		shard.lru.erase(it);
+	}
+
+};
+
+} // namespace jjson
@@ -0,0 +1,428 @@
+#pragma once
+
+#include <lib/jjson/type.h>
+#include <lib/jjson/DomBuilder.h>
+#include <lib/jjson/Escape.h>
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <string_view>
+
+namespace jjson {
+
+/**
+ * Edits the document of a DomBuilder in place, an edit costs O(edit) rather than a serialization and a parse.
+ *
+ * The new nodes come from the rest of the node pool and from the nodes freed by the edits,
+ * the new strings come from DomBuilder::strings(). The strings stay between the quotes in memory,
+ * the nodes may point to the input and to the arena at the same time.
+ * The edits live until the builder parses the next document.
+ *
+ * The values are changed in place, so the links to them stay valid. The key and string arguments are raw text:
+ * the new keys and strings are escaped, a key is found by comparing its escaped form with the key content
+ * as in the input, the escapes of the input are not decoded.
+ * An edit of a container drops its CONTIGUOUS flag, Node::at() walks its list afterwards.
+ * The methods returning a node or bool fail with nullptr or false when the pool is exhausted
+ * or the arguments do not fit: a nullptr value, not a container, a missing key, an index out of the range.
+ * The methods which are not noexcept copy the strings to the arena or intern the keys,
+ * they throw std::bad_alloc as StringArena and KeyTable do, the document is not changed then.
+ *
+ * @tparam A - allocator of the DomBuilder.
+ */
+template<typename A = std::allocator<Node> >
+class DomEditor {
+
+	DomBuilder<A>& _dom;
+
+public:
+
+	DomEditor(const DomEditor&) = delete;
+	DomEditor& operator=(const DomEditor&) = delete;
+
+	DomEditor(DomEditor&& rv) = delete;
+	DomEditor& operator=(DomEditor&&) = delete;
+
+	explicit DomEditor(DomBuilder<A>& dom) noexcept : _dom(dom) {}
+
+	Node* root() noexcept {
+		return _dom.mutable_root();
+	}
+
+	/**
+	 * @return The Key node of the object member, nullptr if there is no such member.
+	 */
+	static Node* find_key(Node* object, std::string_view key) noexcept {
+		if(object == nullptr || object->type != NodeType::Object) {
+			return nullptr;
+		}
+		const size_t escaped_size = Escape::size(key);
+		for(Node* item = object->value; item; item = item->next) {
+			if(key_equals(item->data, key, escaped_size)) {
+				return item;
+			}
+		}
+		return nullptr;
+	}
+
+	/**
+	 * @return The value of the object member, nullptr if there is no such member.
+	 */
+	static Node* member(Node* object, std::string_view key) noexcept {
+		Node* item = find_key(object, key);
+		return item ? item->value : nullptr;
+	}
+
+	static Node* element(Node* array, size_t index) noexcept {
+		if(array == nullptr || array->type != NodeType::Array) {
+			return nullptr;
+		}
+		return const_cast<Node*>(array->at(index));
+	}
+
+	// Values
+
+	bool set_null(Node* value) noexcept {
+		return replace(value, NodeType::Null, "null");
+	}
+
+	bool set_bool(Node* value, bool flag) noexcept {
+		return replace(value, NodeType::Bool, flag ? "true" : "false");
+	}
+
+	bool set_number(Node* value, int64_t number) {
+		char buffer[24];
+		const auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+		return set_number_data(value, std::string_view(buffer, result.ptr - buffer));
+	}
+
+	/**
+	 * The shortest representation which reads back to the same double, NaN and infinity are rejected.
+	 */
+	bool set_number(Node* value, double number) {
+		if(not std::isfinite(number)) {
+			return false;
+		}
+		char buffer[32];
+		const auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+		return set_number_data(value, std::string_view(buffer, result.ptr - buffer));
+	}
+
+	/**
+	 * @param text - the raw text, it is escaped to the arena.
+	 */
+	bool set_string(Node* value, std::string_view text) {
+		return value && replace(value, NodeType::String, escape(text));
+	}
+
+	/**
+	 * Makes the value an empty object.
+	 */
+	bool set_object(Node* value) noexcept {
+		return replace(value, NodeType::Object, "{");
+	}
+
+	/**
+	 * Makes the value an empty array.
+	 */
+	bool set_array(Node* value) noexcept {
+		return replace(value, NodeType::Array, "[");
+	}
+
+	// Objects
+
+	/**
+	 * Appends the member with a null value if the key is new.
+	 * @return The value of the member, the existing one is kept.
+	 */
+	Node* insert_member(Node* object, std::string_view key) {
+		if(object == nullptr || object->type != NodeType::Object) {
+			return nullptr;
+		}
+		const size_t escaped_size = Escape::size(key);
+		Node* last = nullptr;
+		for(Node* item = object->value; item; item = item->next) {
+			if(key_equals(item->data, key, escaped_size)) {
+				return item->value;
+			}
+			last = item;
+		}
+		Node* item = new_key(key);
+		if(item == nullptr) {
+			return nullptr;
+		}
+		Node* value = _dom.new_node(NodeType::Null, "null");
+		if(value == nullptr) {
+			_dom.free_node(item);
+			return nullptr;
+		}
+		item->value = value;
+		link_after(object, last, item);
+		return value;
+	}
+
+	bool remove_member(Node* object, std::string_view key) noexcept {
+		Node* value = detach_member(object, key);
+		if(value == nullptr) {
+			return false;
+		}
+		destroy(value);
+		return true;
+	}
+
+	/**
+	 * Unlinks the member, its Key node is freed.
+	 * @return The value for attach_member(), attach_element() or destroy().
+	 */
+	Node* detach_member(Node* object, std::string_view key) noexcept {
+		if(object == nullptr || object->type != NodeType::Object) {
+			return nullptr;
+		}
+		const size_t escaped_size = Escape::size(key);
+		Node* prev = nullptr;
+		for(Node* item = object->value; item; prev = item, item = item->next) {
+			if(key_equals(item->data, key, escaped_size)) {
+				unlink_after(object, prev);
+				Node* value = item->value;
+				_dom.free_node(item);
+				return value;
+			}
+		}
+		return nullptr;
+	}
+
+	/**
+	 * Makes a detached value the value of the key, the old value of the key is destroyed.
+	 * A value inside the old value is rejected, detach it first.
+	 */
+	bool attach_member(Node* object, std::string_view key, Node* value) {
+		if(object == nullptr || object->type != NodeType::Object || value == nullptr) {
+			return false;
+		}
+		const size_t escaped_size = Escape::size(key);
+		Node* last = nullptr;
+		for(Node* item = object->value; item; item = item->next) {
+			if(key_equals(item->data, key, escaped_size)) {
+				if(item->value == value) {
+					return true;
+				}
+				if(contains(item->value, value)) {
+					return false;
+				}
+				destroy(item->value);
+				item->value = value;
+				value->next = nullptr;
+				return true;
+			}
+			last = item;
+		}
+		Node* item = new_key(key);
+		if(item == nullptr) {
+			return false;
+		}
+		item->value = value;
+		value->next = nullptr;
+		link_after(object, last, item);
+		return true;
+	}
+
+	// Arrays
+
+	/**
+	 * Inserts a null element before the element 'index', an index past the end appends.
+	 * @return The new element.
+	 */
+	Node* insert_element(Node* array, size_t index) noexcept {
+		if(array == nullptr || array->type != NodeType::Array) {
+			return nullptr;
+		}
+		Node* value = _dom.new_node(NodeType::Null, "null");
+		if(value == nullptr) {
+			return nullptr;
+		}
+		link_after(array, before(array, index), value);
+		return value;
+	}
+
+	bool remove_element(Node* array, size_t index) noexcept {
+		Node* value = detach_element(array, index);
+		if(value == nullptr) {
+			return false;
+		}
+		destroy(value);
+		return true;
+	}
+
+	/**
+	 * @return The unlinked element for attach_member(), attach_element() or destroy().
+	 */
+	Node* detach_element(Node* array, size_t index) noexcept {
+		if(array == nullptr || array->type != NodeType::Array || index >= array->size()) {
+			return nullptr;
+		}
+		Node* prev = before(array, index);
+		Node* value = prev ? prev->next : array->value;
+		unlink_after(array, prev);
+		return value;
+	}
+
+	/**
+	 * Inserts a detached value before the element 'index', an index past the end appends.
+	 */
+	bool attach_element(Node* array, size_t index, Node* value) noexcept {
+		if(array == nullptr || array->type != NodeType::Array || value == nullptr) {
+			return false;
+		}
+		link_after(array, before(array, index), value);
+		return true;
+	}
+
+	/**
+	 * Returns a detached value and its subtree to the pool.
+	 */
+	void destroy(Node* value) noexcept {
+		if(value == nullptr) {
+			return;
+		}
+		destroy_children(value);
+		_dom.free_node(value);
+	}
+
+private:
+
+	bool set_number_data(Node* value, std::string_view number) {
+		return value && replace(value, NodeType::Number, _dom.strings().copy_quoted(number));
+	}
+
+	std::string_view escape(std::string_view text) {
+		char* data = _dom.strings().allocate_quoted(Escape::size(text));
+		const char* end = Escape::write(data, text);
+		return std::string_view(data, end - data);
+	}
+
+	/**
+	 * Compares the key content with the escaped key without writing it out.
+	 * @param escaped_size - Escape::size(key).
+	 */
+	static bool key_equals(std::string_view data, std::string_view key, size_t escaped_size) noexcept {
+		if(data.size() != escaped_size) {
+			return false;
+		}
+		while(true) {
+			const size_t plain = Escape::plain_prefix(key.data(), key.size());
+			if(data.compare(0, plain, key.data(), plain) != 0) {
+				return false;
+			}
+			data.remove_prefix(plain);
+			key.remove_prefix(plain);
+			if(key.empty()) {
+				return true;
+			}
+			char sequence[Escape::MAX_SEQUENCE];
+			const size_t len = Escape::write_sequence(sequence, uint8_t(key[0])) - sequence;
+			if(data.compare(0, len, sequence, len) != 0) {
+				return false;
+			}
+			data.remove_prefix(len);
+			key.remove_prefix(1u);
+		}
+	}
+
+	/**
+	 * The key is escaped and interned before the node is taken, a throw leaves the pool as it was.
+	 */
+	Node* new_key(std::string_view key) {
+		const std::string_view data = escape(key);
+		const uint32_t key_id = _dom.key_table() ? _dom.key_table()->intern(data) : Node::NO_KEY_ID;
+		Node* item = _dom.new_node(NodeType::Key, data);
+		if(item) {
+			item->key_id = key_id;
+		}
+		return item;
+	}
+
+	/**
+	 * Changes the value in place, its old children are freed.
+	 */
+	bool replace(Node* value, NodeType type, std::string_view data) noexcept {
+		if(value == nullptr) {
+			return false;
+		}
+		destroy_children(value);
+		value->value = nullptr;
+		value->data = data;
+		value->key_id = Node::NO_KEY_ID;
+		if(type == NodeType::Object || type == NodeType::Array) {
+			value->child_count = 0;
+		}
+		value->type = type;
+		value->flags = 0;
+		return true;
+	}
+
+	/**
+	 * @return true if the node is in the subtree of the root, the root included.
+	 */
+	static bool contains(const Node* root, const Node* node) noexcept {
+		if(root == node) {
+			return true;
+		}
+		for(const Node* child = root->value; child; child = child->next) {
+			if(contains(child, node)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void destroy_children(Node* value) noexcept {
+		Node* child = value->value;
+		while(child) {
+			Node* next = child->next;
+			destroy(child);
+			child = next;
+		}
+		value->value = nullptr;
+	}
+
+	/**
+	 * @return The element before the element 'index', nullptr for the first one.
+	 */
+	static Node* before(Node* array, size_t index) noexcept {
+		if(index == 0 || array->value == nullptr) {
+			return nullptr;
+		}
+		Node* result = array->value;
+		for(size_t i = 1u; i < index && result->next; ++i) {
+			result = result->next;
+		}
+		return result;
+	}
+
+	static void link_after(Node* container, Node* prev, Node* node) noexcept {
+		if(prev) {
+			node->next = prev->next;
+			prev->next = node;
+		} else {
+			node->next = container->value;
+			container->value = node;
+		}
+		container->child_count++;
+		container->flags &= ~Node::CONTIGUOUS;
+	}
+
+	static void unlink_after(Node* container, Node* prev) noexcept {
+		Node* node = prev ? prev->next : container->value;
+		if(prev) {
+			prev->next = node->next;
+		} else {
+			container->value = node->next;
+		}
+		node->next = nullptr;
+		container->child_count--;
+		container->flags &= ~Node::CONTIGUOUS;
+	}
+
+};
+
+} // namespace jjson
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <lib/jjson/type.h>
+#include <lib/jjson/DomIterator.h>
+
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/uio.h>
+
+namespace jjson {
+
+/**
+ * Serializes a DOM to a list of iovecs for writev()/sendmsg(), the strings, the numbers and the literals
+ * are referenced where they are rather than copied: in the input or in the string arena of the edits.
+ * Only the glue which is not found in the input, e.g. the ',' after an edited value, goes to a small
+ * side buffer, so a document which is parsed, edited in a few places and forwarded costs a few iovecs.
+ *
+ * The adjacent references are coalesced: a value is taken with the glue and the whitespace
+ * which follow it in the input, so an untouched subtree of a minified input is a single iovec.
+ * The output is the JSON of DomJsonStringBuilder with the whitespace of the input between the coalesced tokens.
+ *
+ * IMPORTANT:
+ * - The iovecs point to the input, to the strings of the DomBuilder and to the builder itself,
+ *   they are valid until any of them changes: the next parse, reset() or build().
+ * - The strings must be between the quotes in memory, as the input and StringArena::allocate_quoted() keep them.
+ */
+class DomIovecBuilder {
+
+	/** An iovec of the side buffer keeps the offset in iov_base until the walk ends. */
+	std::vector<iovec> _iovecs;
+	std::vector<size_t> _side_iovecs;
+	std::string _side;
+	const char* _input_begin;
+	const char* _input_end;
+	bool _last_side;
+
+public:
+
+	DomIovecBuilder(const DomIovecBuilder&) = delete;
+	DomIovecBuilder& operator=(const DomIovecBuilder&) = delete;
+
+	DomIovecBuilder(DomIovecBuilder&& rv) = delete;
+	DomIovecBuilder& operator=(DomIovecBuilder&&) = delete;
+
+	DomIovecBuilder() noexcept : _input_begin(nullptr), _input_end(nullptr), _last_side(false) {}
+
+	/**
+	 * Serializes the subtree of the root, the walk is not recursive, see DomWalker.
+	 * @param input - the bytes the DOM is parsed from, the glue is searched there. An empty input is allowed,
+	 * the values are still referenced but the glue always goes to the side buffer.
+	 * @return false if the document is deeper than the walker stack, the list is empty.
+	 * Throws std::bad_alloc when the list or the side buffer can not grow, the list is reset by the next build().
+	 */
+	bool build(const Node* root, std::string_view input) {
+		reset();
+		_input_begin = input.data();
+		_input_end = input.data() + input.size();
+		DomWalker<> walker(root);
+		if(walker.done()) {
+			return true;
+		}
+		do {
+			const Step& step = walker.step();
+			const Node* node = step.node;
+			if(step.visit == Visit::Enter) {
+				enter(node);
+			} else {
+				leave(node);
+				if(step.depth > 0 && node->next) {
+					glue(',');
+				}
+			}
+		} while(walker.next());
+		if(walker.overflow()) {
+			reset();
+			return false;
+		}
+		for(const size_t index : _side_iovecs) {
+			iovec& iov = _iovecs[index];
+			iov.iov_base = _side.data() + reinterpret_cast<size_t>(iov.iov_base);
+		}
+		return true;
+	}
+
+	void reset() noexcept {
+		_iovecs.clear();
+		_side_iovecs.clear();
+		_side.clear();
+		_last_side = false;
+	}
+
+	const std::vector<iovec>& iovecs() const noexcept {
+		return _iovecs;
+	}
+
+	/**
+	 * @return The bytes copied to the side buffer by the last build().
+	 */
+	size_t side_size() const noexcept {
+		return _side.size();
+	}
+
+	/**
+	 * @return The size of the output.
+	 */
+	size_t size() const noexcept {
+		size_t result = 0;
+		for(const auto& iov : _iovecs) {
+			result += iov.iov_len;
+		}
+		return result;
+	}
+
+	/**
+	 * Gathers the output to a string, for the logs and the comparisons.
+	 */
+	std::string to_string() const {
+		std::string result;
+		result.reserve(size());
+		for(const auto& iov : _iovecs) {
+			result.append(static_cast<const char*>(iov.iov_base), iov.iov_len);
+		}
+		return result;
+	}
+
+	/**
+	 * Writes the output to a descriptor with writev(), IOV_MAX iovecs at a time, the short writes are resumed.
+	 * @return false on an error, see errno.
+	 */
+	bool write(int fd) const noexcept {
+		size_t index = 0;
+		size_t offset = 0;
+		while(index < _iovecs.size()) {
+			iovec batch[IOV_MAX];
+			size_t count = 0;
+			for(; count < size_t(IOV_MAX) && index + count < _iovecs.size(); ++count) {
+				batch[count] = _iovecs[index + count];
+			}
+			batch[0].iov_base = static_cast<char*>(batch[0].iov_base) + offset;
+			batch[0].iov_len -= offset;
+			ssize_t written = writev(fd, batch, int(count));
+			if(written < 0) {
+				if(errno == EINTR) {
+					continue;
+				}
+				return false;
+			}
+			auto left = size_t(written);
+			while(index < _iovecs.size() && left >= _iovecs[index].iov_len - offset) {
+				left -= _iovecs[index].iov_len - offset;
+				offset = 0;
+				index++;
+			}
+			offset += left;
+		}
+		return true;
+	}
+
+private:
+
+	void enter(const Node* node) {
+		switch (node->type) {
+			case NodeType::Object:
+			case NodeType::Array:
+				// The data is the '{' or '[' token.
+				reference(node->data.data(), node->data.size());
+				break;
+
+			case NodeType::String:
+				reference(node->data.data() - 1u, node->data.size() + 2u);
+				break;
+
+			case NodeType::Number:
+			case NodeType::Bool:
+			case NodeType::Null:
+				reference(node->data.data(), node->data.size());
+				break;
+
+			case NodeType::Key:
+				reference(node->data.data() - 1u, node->data.size() + 2u);
+				glue(':');
+				break;
+
+			case NodeType::Unknown:
+
+			default:
+				break;
+		}
+	}
+
+	void leave(const Node* node) {
+		switch (node->type) {
+			case NodeType::Object:
+				glue('}');
+				break;
+
+			case NodeType::Array:
+				glue(']');
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	bool in_input(const char* data) const noexcept {
+		return data >= _input_begin && data < _input_end;
+	}
+
+	static bool is_space(char c) noexcept {
+		return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+	}
+
+	/**
+	 * @return The end of the last reference or nullptr if the last iovec is in the side buffer.
+	 */
+	const char* last_end() const noexcept {
+		if(_iovecs.empty() || _last_side) {
+			return nullptr;
+		}
+		const iovec& last = _iovecs.back();
+		return static_cast<const char*>(last.iov_base) + last.iov_len;
+	}
+
+	void reference(const char* data, size_t size) {
+		const char* end = last_end();
+		if(end && (end == data || (in_input(end) && in_input(data) && data > end && spaces(end, data)))) {
+			_iovecs.back().iov_len += data + size - end;
+			return;
+		}
+		_iovecs.push_back(iovec{const_cast<char*>(data), size});
+		_last_side = false;
+	}
+
+	/**
+	 * Extends the last reference up to the byte if only whitespace precedes it in the input,
+	 * otherwise the byte goes to the side buffer.
+	 */
+	void glue(char c) {
+		const char* end = last_end();
+		if(end && in_input(end)) {
+			const char* p = end;
+			while(p < _input_end && is_space(*p)) {
+				p++;
+			}
+			if(p < _input_end && *p == c) {
+				_iovecs.back().iov_len += p + 1 - end;
+				return;
+			}
+		}
+		if(_last_side) {
+			_iovecs.back().iov_len++;
+		} else {
+			_side_iovecs.push_back(_iovecs.size());
+			_iovecs.push_back(iovec{reinterpret_cast<void*>(_side.size()), 1u});
+			_last_side = true;
+		}
+		_side.push_back(c);
+	}
+
+	static bool spaces(const char* begin, const char* end) noexcept {
+		for(; begin < end; ++begin) {
+			if(not is_space(*begin)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+};
+
+} // namespace jjson
@@ -0,0 +1,348 @@
+#pragma once
+
+#include <lib/jjson/type.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+
+namespace jjson {
+
+/**
+ * The iterator over a list of the nodes linked by 'next': the elements of Array, the keys of Object.
+ */
+class NodeIterator {
+
+	const Node* _node;
+
+public:
+
+	using iterator_category = std::forward_iterator_tag;
+	using value_type = const Node*;
+	using difference_type = std::ptrdiff_t;
+	using pointer = const Node* const*;
+	using reference = const Node*;
+
+	explicit NodeIterator(const Node* node = nullptr) noexcept : _node(node) {}
+
+	const Node* operator*() const noexcept {
+		return _node;
+	}
+
+	NodeIterator& operator++() noexcept {
+		_node = _node->next;
+		return *this;
+	}
+
+	NodeIterator operator++(int) noexcept {
+		NodeIterator result = *this;
+		_node = _node->next;
+		return result;
+	}
+
+	bool operator==(const NodeIterator& rv) const noexcept {
+		return _node == rv._node;
+	}
+
+	bool operator!=(const NodeIterator& rv) const noexcept {
+		return _node != rv._node;
+	}
+
+};
+
+/**
+ * A key and its value, see members().
+ */
+struct Member {
+	const Node* key;
+	const Node* value;
+
+	std::string_view name() const noexcept {
+		return key->data;
+	}
+};
+
+class MemberIterator {
+
+	const Node* _key;
+
+public:
+
+	using iterator_category = std::forward_iterator_tag;
+	using value_type = Member;
+	using difference_type = std::ptrdiff_t;
+	using pointer = const Member*;
+	using reference = Member;
+
+	explicit MemberIterator(const Node* key = nullptr) noexcept : _key(key) {}
+
+	Member operator*() const noexcept {
+		return Member{_key, _key->value};
+	}
+
+	MemberIterator& operator++() noexcept {
+		_key = _key->next;
+		return *this;
+	}
+
+	MemberIterator operator++(int) noexcept {
+		MemberIterator result = *this;
+		_key = _key->next;
+		return result;
+	}
+
+	bool operator==(const MemberIterator& rv) const noexcept {
+		return _key == rv._key;
+	}
+
+	bool operator!=(const MemberIterator& rv) const noexcept {
+		return _key != rv._key;
+	}
+
+};
+
+template <typename I>
+class NodeRange {
+
+	I _begin;
+
+public:
+
+	explicit NodeRange(const Node* first) noexcept : _begin(first) {}
+
+	I begin() const noexcept {
+		return _begin;
+	}
+
+	I end() const noexcept {
+		return I();
+	}
+
+};
+
+/**
+ * for(const Node* element : children(array))
+ * @return The children of Object and Array, the value of Key, nothing for the other nodes.
+ */
+inline NodeRange<NodeIterator> children(const Node* node) noexcept {
+	return NodeRange<NodeIterator>(node ? node->value : nullptr);
+}
+
+/**
+ * for(const Member member : members(object))
+ * @return The key and value pairs of Object, nothing for the other nodes.
+ */
+inline NodeRange<MemberIterator> members(const Node* node) noexcept {
+	return NodeRange<MemberIterator>(node && node->type == NodeType::Object ? node->value : nullptr);
+}
+
+enum class Visit : char {
+	Enter,
+	Leave
+};
+
+/**
+ * A node of the traversal, 'depth' is 0 for the root, the value of a Key is one level deeper than the Key.
+ */
+struct Step {
+	const Node* node;
+	size_t depth;
+	Visit visit;
+};
+
+/**
+ * Walks the subtree of the root in the document order without the recursion:
+ * every node is entered, then its children are walked, then it is left.
+ * The path from the root is an explicit stack of MAX_DEPTH nodes, a Key and its value take two levels.
+ * The walk stops with overflow() on a deeper document.
+ *
+ * @tparam MAX_DEPTH - the stack size, the default covers the default depth of Validator.
+ */
+template <size_t MAX_DEPTH = 2048u>
+class DomWalker {
+
+	const Node* _stack[MAX_DEPTH];
+	size_t _size;
+	Step _step;
+	bool _overflow;
+
+public:
+
+	DomWalker(const DomWalker&) = delete;
+	DomWalker& operator=(const DomWalker&) = delete;
+
+	DomWalker(DomWalker&& rv) = delete;
+	DomWalker& operator=(DomWalker&&) = delete;
+
+	/**
+	 * The first step is entering the root, nullptr is an empty walk.
+	 */
+	explicit DomWalker(const Node* root) noexcept : _size(0), _step{root, 0, Visit::Enter}, _overflow(false) {
+		if(root) {
+			_stack[_size++] = root;
+		}
+	}
+
+	bool done() const noexcept {
+		return _size == 0;
+	}
+
+	/**
+	 * @return true if the walk has stopped on a document deeper than MAX_DEPTH.
+	 */
+	bool overflow() const noexcept {
+		return _overflow;
+	}
+
+	const Step& step() const noexcept {
+		return _step;
+	}
+
+	/**
+	 * @return false at the end of the walk.
+	 */
+	bool next() noexcept {
+		if(_size == 0) {
+			return false;
+		}
+		if(_step.visit == Visit::Enter) {
+			const Node* child = _step.node->value;
+			if(child == nullptr) {
+				_step.visit = Visit::Leave;
+				return true;
+			}
+			if(_size == MAX_DEPTH) {
+				_overflow = true;
+				_size = 0;
+				return false;
+			}
+			_stack[_size++] = child;
+			_step = Step{child, _size - 1u, Visit::Enter};
+			return true;
+		}
+
+		const Node* node = _stack[_size - 1u];
+		// The siblings of the root are not in its subtree.
+		if(_size > 1u && node->next) {
+			_stack[_size - 1u] = node->next;
+			_step = Step{node->next, _size - 1u, Visit::Enter};
+			return true;
+		}
+		_size--;
+		if(_size == 0) {
+			return false;
+		}
+		_step = Step{_stack[_size - 1u], _size - 1u, Visit::Leave};
+		return true;
+	}
+
+};
+
+/**
+ * The range of the steps of one kind: Visit::Enter is the pre-order, Visit::Leave is the post-order.
+ * The range owns the stack, the iterators point to it. Keep the range to check overflow() after the loop.
+ */
+template <Visit V, size_t MAX_DEPTH = 2048u>
+class Traversal {
+
+	DomWalker<MAX_DEPTH> _walker;
+
+public:
+
+	class Iterator {
+
+		DomWalker<MAX_DEPTH>* _walker;
+
+	public:
+
+		using iterator_category = std::input_iterator_tag;
+		using value_type = Step;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const Step*;
+		using reference = const Step&;
+
+		explicit Iterator(DomWalker<MAX_DEPTH>* walker = nullptr) noexcept : _walker(walker) {
+			if(_walker && (_walker->done() || _walker->step().visit != V)) {
+				++(*this);
+			}
+		}
+
+		const Step& operator*() const noexcept {
+			return _walker->step();
+		}
+
+		const Step* operator->() const noexcept {
+			return &_walker->step();
+		}
+
+		Iterator& operator++() noexcept {
+			while(_walker->next()) {
+				if(_walker->step().visit == V) {
+					return *this;
+				}
+			}
+			_walker = nullptr;
+			return *this;
+		}
+
+		bool operator==(const Iterator& rv) const noexcept {
+			return _walker == rv._walker;
+		}
+
+		bool operator!=(const Iterator& rv) const noexcept {
+			return _walker != rv._walker;
+		}
+
+	};
+
+	explicit Traversal(const Node* root) noexcept : _walker(root) {}
+
+	Iterator begin() noexcept {
+		return Iterator(&_walker);
+	}
+
+	Iterator end() noexcept {
+		return Iterator();
+	}
+
+	bool overflow() const noexcept {
+		return _walker.overflow();
+	}
+
+};
+
+/**
+ * for(const Step& step : PreOrder<>(root))
+ */
+template <size_t MAX_DEPTH = 2048u>
+using PreOrder = Traversal<Visit::Enter, MAX_DEPTH>;
+
+/**
+ * for(const Step& step : PostOrder<>(root))
+ */
+template <size_t MAX_DEPTH = 2048u>
+using PostOrder = Traversal<Visit::Leave, MAX_DEPTH>;
+
+/**
+ * Calls visitor.enter(node, depth) before the children of a node and visitor.leave(node, depth) after them.
+ * @return false if the document is deeper than MAX_DEPTH, the visitor has seen a part of it.
+ */
+template <size_t MAX_DEPTH = 2048u, typename V>
+bool visit(const Node* root, V& visitor) {
+	DomWalker<MAX_DEPTH> walker(root);
+	if(walker.done()) {
+		return true;
+	}
+	do {
+		const Step& step = walker.step();
+		if(step.visit == Visit::Enter) {
+			visitor.enter(step.node, step.depth);
+		} else {
+			visitor.leave(step.node, step.depth);
+		}
+	} while(walker.next());
+	return not walker.overflow();
+}
+
+} // namespace jjson
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <lib/jjson/type.h>
+#include <lib/jjson/DomIterator.h>
 
 #include <cstdio>
 #include <string>
@@ -9,55 +10,89 @@ namespace jjson {
 
 struct DomJsonStringBuilder {
 
-	static std::string to_json_string(const jjson::Node* root) noexcept {
-		std::string result;
-		while (root) {
-			switch (root->type) {
-				case NodeType::Object:
-					result.push_back('{');
-					result += to_json_string(root->value);
-					result.push_back('}');
-					break;
-
-				case NodeType::Array:
-					result.push_back('[');
-					result += to_json_string(root->value);
-					result.push_back(']');
-					break;
-
-				case NodeType::String:
-					result.push_back('"');
-					result.append(root->data);
-					result.push_back('"');
-					break;
-
-				case NodeType::Number:
-				case NodeType::Bool:
-				case NodeType::Null:
-					result.append(root->data);
-					break;
-
-				case NodeType::Key:
-					result.push_back('"');
-					result.append(root->data);
-					result.push_back('"');
-					result.push_back(':');
-					result += to_json_string(root->value);
-					break;
-
-				case NodeType::Unknown:
-
-				default:
-					break;
+	/**
+	 * Appends the JSON of the subtree of the root, the walk is not recursive, see DomWalker.
+	 * A nullptr root appends nothing.
+	 * @tparam MAX_DEPTH - the walker stack size, see DomWalker.
+	 * @return false if the document is deeper than the walker stack, 'result' is left as it was.
+	 */
+	template <size_t MAX_DEPTH = 2048u>
+	static bool to_json_string(const jjson::Node* root, std::string& result) {
+		const size_t size = result.size();
+		DomWalker<MAX_DEPTH> walker(root);
+		if(walker.done()) {
+			return true;
+		}
+		do {
+			const Step& step = walker.step();
+			const Node* node = step.node;
+			if(step.visit == Visit::Enter) {
+				enter(result, node);
+			} else {
+				leave(result, node);
+				if(step.depth > 0 && node->next) {
+					result.push_back(',');
+				}
 			}
+		} while(walker.next());
+		if(walker.overflow()) {
+			result.resize(size);
+			return false;
+		}
+		return true;
+	}
 
-			if (root->next) {
-				result.push_back(',');
-			}
+private:
+
+	static void enter(std::string& result, const Node* node) {
+		switch (node->type) {
+			case NodeType::Object:
+				result.push_back('{');
+				break;
+
+			case NodeType::Array:
+				result.push_back('[');
+				break;
+
+			case NodeType::String:
+				result.push_back('"');
+				result.append(node->data);
+				result.push_back('"');
+				break;
+
+			case NodeType::Number:
+			case NodeType::Bool:
+			case NodeType::Null:
+				result.append(node->data);
+				break;
+
+			case NodeType::Key:
+				result.push_back('"');
+				result.append(node->data);
+				result.push_back('"');
+				result.push_back(':');
+				break;
+
+			case NodeType::Unknown:
+
+			default:
+				break;
+		}
+	}
+
+	static void leave(std::string& result, const Node* node) {
+		switch (node->type) {
+			case NodeType::Object:
+				result.push_back('}');
+				break;
+
+			case NodeType::Array:
+				result.push_back(']');
+				break;
 
-			root = root->next;
+			default:
+				break;
 		}
-		return result;
 	}
 
 };
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <lib/jjson/type.h>
+#include <lib/jjson/DomIterator.h>
 
 #include <cstdio>
 #include <string>
@@ -9,8 +10,17 @@ namespace jjson {
 
 struct DomTreeStringBuilder {
 
+	/**
+	 * Prints the subtree of the root in the pre-order, the walk is not recursive, see PreOrder.
+	 */
 	static void dump(FILE* out, const jjson::Node* root) {
-		dump(out, root, 0);
+		PreOrder<> walk(root);
+		for(const Step& step : walk) {
+			dump(out, step.node, unsigned(step.depth));
+		}
+		if(walk.overflow()) {
+			fprintf(out, "the document is too deep\n");
+		}
 	}
 
 	static const char* to_string(const jjson::NodeType& value) {
@@ -39,26 +49,22 @@ struct DomTreeStringBuilder {
 
 private:
 
-	static void dump(FILE* out, const jjson::Node* root, unsigned level) {
-		if(root) {
-			fprintf(out, "%.*s [%u] ", int(level * 4), "", level);
-			fprintf(out, " %s ", to_string(root->type));
+	static void dump(FILE* out, const jjson::Node* node, unsigned level) {
+		fprintf(out, "%.*s [%u] ", int(level * 4), "", level);
+		fprintf(out, " %s ", to_string(node->type));
 
-			switch(root->type) {
-				case NodeType::Key :
-				case NodeType::String :
-				case NodeType::Number :
-					fprintf(out, " '%.*s'", int(root->data.length()), root->data.begin());
-				break;
-
-				default:
-					break;
-			}
+		switch(node->type) {
+			case NodeType::Key :
+			case NodeType::String :
+			case NodeType::Number :
+				fprintf(out, " '%.*s'", int(node->data.length()), node->data.begin());
+			break;
 
-			fprintf(out, "\n");
-			dump(out, root->value, level + 1u);
-			dump(out, root->next, level);
+			default:
+				break;
 		}
+
+		fprintf(out, "\n");
 	}
 
 };
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <lib/jjson/Kernels.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace jjson {
+
+/**
+ * Escapes a text to the content of a JSON string: '"', '\' and the control characters.
+ * The other bytes, including UTF-8, are copied as they are.
+ * unescape() is the reverse, it decodes the content of a string as in the input.
+ */
+class Escape {
+
+	static constexpr char HEX[] = "0123456789abcdef";
+
+public:
+
+	/** The longest escape sequence, \u00XX. */
+	static constexpr size_t MAX_SEQUENCE = 6u;
+
+	/**
+	 * @return The escape sequence of the byte or nullptr if the byte is copied as it is,
+	 * the \u00XX sequences are written by write_sequence().
+	 */
+	static constexpr const char* sequence(uint8_t c) noexcept {
+		switch(c) {
+			case '"':
+				return "\\\"";
+			case '\\':
+				return "\\\\";
+			case '\b':
+				return "\\b";
+			case '\f':
+				return "\\f";
+			case '\n':
+				return "\\n";
+			case '\r':
+				return "\\r";
+			case '\t':
+				return "\\t";
+			default:
+				return nullptr;
+		}
+	}
+
+	static constexpr bool needs_escape(uint8_t c) noexcept {
+		return c < 0x20u || c == '"' || c == '\\';
+	}
+
+	/**
+	 * @return The length of the leading run which needs no escapes, see Kernels::find_escape.
+	 */
+	static size_t plain_prefix(const char* data, size_t size) noexcept {
+		const auto begin = reinterpret_cast<const uint8_t*>(data);
+		return Kernels::get().find_escape(begin, begin + size) - begin;
+	}
+
+	/**
+	 * Writes the escape sequence of a byte which needs_escape().
+	 * @return The end of the written bytes, at most MAX_SEQUENCE.
+	 */
+	static constexpr char* write_sequence(char* out, uint8_t c) noexcept {
+		const char* seq = sequence(c);
+		if(seq) {
+			out[0] = seq[0];
+			out[1] = seq[1];
+			return out + 2u;
+		}
+		out[0] = '\\';
+		out[1] = 'u';
+		out[2] = '0';
+		out[3] = '0';
+		out[4] = HEX[c >> 4u];
+		out[5] = HEX[c & 0xFu];
+		return out + 6u;
+	}
+
+	/**
+	 * @return The size of the escaped text.
+	 */
+	static size_t size(std::string_view text) noexcept {
+		size_t result = text.size();
+		while(true) {
+			text.remove_prefix(plain_prefix(text.data(), text.size()));
+			if(text.empty()) {
+				return result;
+			}
+			result += sequence(uint8_t(text[0])) ? 1u : 5u;
+			text.remove_prefix(1u);
+		}
+	}
+
+	/**
+	 * Writes size(text) bytes to 'out'.
+	 * @return The end of the written bytes.
+	 */
+	static char* write(char* out, std::string_view text) noexcept {
+		while(true) {
+			const size_t plain = plain_prefix(text.data(), text.size());
+			if(plain) {
+				memcpy(out, text.data(), plain);
+				out += plain;
+			}
+			text.remove_prefix(plain);
+			if(text.empty()) {
+				return out;
+			}
+			out = write_sequence(out, uint8_t(text[0]));
+			text.remove_prefix(1u);
+		}
+	}
+
+	/**
+	 * Appends the decoded content of a string to 'out', a \uXXXX escape becomes UTF-8.
+	 * @return false on an invalid escape sequence or an unpaired surrogate, 'out' holds a part of the text.
+	 */
+	static bool unescape(std::string& out, std::string_view content) {
+		while(true) {
+			const auto escape = content.empty() ? nullptr
+				: static_cast<const char*>(memchr(content.data(), '\\', content.size()));
+			if(escape == nullptr) {
+				out.append(content);
+				return true;
+			}
+			out.append(content.data(), escape - content.data());
+			content.remove_prefix(escape - content.data());
+			if(content.size() < 2u) {
+				return false;
+			}
+			char c;
+			switch(content[1]) {
+				case '"':
+				case '\\':
+				case '/':
+					c = content[1];
+					break;
+				case 'b':
+					c = '\b';
+					break;
+				case 'f':
+					c = '\f';
+					break;
+				case 'n':
+					c = '\n';
+					break;
+				case 'r':
+					c = '\r';
+					break;
+				case 't':
+					c = '\t';
+					break;
+				case 'u':
+					if(not unescape_unicode(out, content)) {
+						return false;
+					}
+					continue;
+				default:
+					return false;
+			}
+			out.push_back(c);
+			content.remove_prefix(2u);
+		}
+	}
+
+private:
+
+	/**
+	 * @return The value of four hex digits or a negative value.
+	 */
+	static int32_t hex4(const char* data) noexcept {
+		int32_t result = 0;
+		for(size_t i = 0; i < 4u; ++i) {
+			const auto c = uint8_t(data[i]);
+			int32_t digit;
+			if(c >= '0' && c <= '9') {
+				digit = c - '0';
+			} else if((c | 0x20u) >= 'a' && (c | 0x20u) <= 'f') {
+				digit = (c | 0x20u) - 'a' + 10;
+			} else {
+				return -1;
+			}
+			result = (result << 4) | digit;
+		}
+		return result;
+	}
+
+	/**
+	 * Decodes \uXXXX or a surrogate pair \uD8XX\uDCXX at the start of the content and removes it.
+	 */
+	static bool unescape_unicode(std::string& out, std::string_view& content) {
+		if(content.size() < 6u) {
+			return false;
+		}
+		int32_t code = hex4(content.data() + 2u);
+		if(code < 0 || (code >= 0xDC00 && code <= 0xDFFF)) {
+			return false;
+		}
+		size_t len = 6u;
+		if(code >= 0xD800 && code <= 0xDBFF) {
+			if(content.size() < 12u || content[6] != '\\' || content[7] != 'u') {
+				return false;
+			}
+			const int32_t low = hex4(content.data() + 8u);
+			if(low < 0xDC00 || low > 0xDFFF) {
+				return false;
+			}
+			code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+			len = 12u;
+		}
+		content.remove_prefix(len);
+
+		char utf8[4];
+		size_t size;
+		if(code < 0x80) {
+			utf8[0] = char(code);
+			size = 1u;
+		} else if(code < 0x800) {
+			utf8[0] = char(0xC0 | (code >> 6));
+			utf8[1] = char(0x80 | (code & 0x3F));
+			size = 2u;
+		} else if(code < 0x10000) {
+			utf8[0] = char(0xE0 | (code >> 12));
+			utf8[1] = char(0x80 | ((code >> 6) & 0x3F));
+			utf8[2] = char(0x80 | (code & 0x3F));
+			size = 3u;
+		} else {
+			utf8[0] = char(0xF0 | (code >> 18));
+			utf8[1] = char(0x80 | ((code >> 12) & 0x3F));
+			utf8[2] = char(0x80 | ((code >> 6) & 0x3F));
+			utf8[3] = char(0x80 | (code & 0x3F));
+			size = 4u;
+		}
+		out.append(utf8, size);
+		return true;
+	}
+
+};
+
+} // namespace jjson
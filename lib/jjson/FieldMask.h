@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace jjson {
+
+/**
+ * A tree of the object keys for the projection, see SaxParser::set_mask().
+ *
+ * The paths are the dot separated keys, e.g. "user.name".
+ * The arrays are transparent: the mask of an array applies to its elements.
+ * The last key of a path takes the whole value, the nested keys filter only the objects,
+ * the other values of such a key pass as they are.
+ * The keys are compared with the key content as in the input, the escapes are not decoded.
+ */
+class FieldMask {
+
+	using Children = std::vector<std::pair<std::string, size_t> >;
+
+	std::vector<Children> _nodes;
+
+public:
+
+	/** The whole value passes. */
+	static constexpr size_t ALL = SIZE_MAX;
+	/** The key is not in the mask. */
+	static constexpr size_t NONE = SIZE_MAX - 1u;
+	static constexpr size_t ROOT = 0;
+
+	FieldMask() : _nodes(1u) {}
+
+	FieldMask(std::initializer_list<std::string_view> paths) : _nodes(1u) {
+		for(const auto path : paths) {
+			add(path);
+		}
+	}
+
+	void add(std::string_view path) {
+		size_t node = ROOT;
+		while(node != ALL) {
+			const size_t dot = path.find('.');
+			const std::string_view key = path.substr(0, dot);
+			const bool last = dot == std::string_view::npos;
+
+			size_t child = find(node, key);
+			if(child == NONE) {
+				child = last ? ALL : _nodes.size();
+				_nodes[node].emplace_back(std::string(key), child);
+				if(child != ALL) {
+					_nodes.emplace_back();
+				}
+			} else if(last) {
+				// The whole value wins over the nested keys.
+				set_child(node, key, ALL);
+				child = ALL;
+			}
+
+			if(last) {
+				break;
+			}
+			node = child;
+			path.remove_prefix(dot + 1u);
+		}
+	}
+
+	/**
+	 * @return The mask of the value of the key: a node, ALL or NONE.
+	 */
+	size_t find(size_t node, std::string_view key) const noexcept {
+		if(node == ALL) {
+			return ALL;
+		}
+		for(const auto& child : _nodes[node]) {
+			if(child.first == key) {
+				return child.second;
+			}
+		}
+		return NONE;
+	}
+
+	bool empty() const noexcept {
+		return _nodes[ROOT].empty();
+	}
+
+	void clear() {
+		_nodes.assign(1u, Children());
+	}
+
+private:
+
+	void set_child(size_t node, std::string_view key, size_t child) noexcept {
+		for(auto& item : _nodes[node]) {
+			if(item.first == key) {
+				item.second = child;
+			}
+		}
+	}
+
+};
+
+} // namespace jjson
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <lib/jjson/PreadBlockReader.h>
+#include <lib/jjson/UringBlockReader.h>
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace jjson {
+
+/**
+ * Reads a file in blocks with io_uring and falls back to the pread() thread if io_uring
+ * is not available (old kernel, seccomp, io_uring_disabled), see PreadBlockReader for the interface.
+ * A read which fails in io_uring (e.g. the opcode is not supported) falls back too,
+ * pread() resumes after the blocks already returned and reports the errors of the file itself,
+ * the reader stays on pread() for the next files.
+ */
+class FileBlockReader {
+public:
+
+	enum class Backend : char {
+		Uring,
+		Pread
+	};
+
+private:
+
+	const size_t _block_size;
+	const size_t _buffer_count;
+	std::unique_ptr<UringBlockReader> _uring;
+	std::unique_ptr<PreadBlockReader> _pread;
+	std::string _file_name;
+
+public:
+
+	explicit FileBlockReader(size_t block_size = 1024u * 1024u, size_t buffer_count = 2u, Backend backend = Backend::Uring) :
+		_block_size(block_size), _buffer_count(buffer_count) {
+		if(backend == Backend::Uring) {
+			_uring = std::make_unique<UringBlockReader>(block_size, buffer_count);
+		} else {
+			_pread = std::make_unique<PreadBlockReader>(block_size, buffer_count);
+		}
+	}
+
+	bool open(const char* file_name) {
+		_file_name = file_name;
+		if(_uring) {
+			if(_uring->open(file_name)) {
+				return true;
+			}
+			if(_uring->failed() && _uring->error().compare(0, 8, "io_uring") != 0) {
+				// Not an io_uring failure, e.g. the file does not exist.
+				return false;
+			}
+			fall_back();
+		}
+		return _pread->open(file_name);
+	}
+
+	void close() noexcept {
+		if(_uring) {
+			_uring->close();
+		} else {
+			_pread->close();
+		}
+	}
+
+	bool next(std::string_view& block) {
+		if(_uring) {
+			if(_uring->next(block)) {
+				return true;
+			}
+			if(not _uring->failed()) {
+				return false;
+			}
+			const uint64_t offset = _uring->delivered();
+			fall_back();
+			if(not _pread->open(_file_name.c_str(), offset)) {
+				return false;
+			}
+		}
+		return _pread->next(block);
+	}
+
+	bool failed() const noexcept {
+		return _uring ? _uring->failed() : _pread->failed();
+	}
+
+	const std::string& error() const noexcept {
+		return _uring ? _uring->error() : _pread->error();
+	}
+
+	Backend backend() const noexcept {
+		return _uring ? Backend::Uring : Backend::Pread;
+	}
+
+private:
+
+	void fall_back() {
+		_uring.reset();
+		_pread = std::make_unique<PreadBlockReader>(_block_size, _buffer_count);
+	}
+
+};
+
+} // namespace jjson
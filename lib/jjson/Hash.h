@@ -0,0 +1,172 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <endian.h>
+
+namespace jjson {
+
+/**
+ * Fast non-cryptographic 64-bit hash.
+ *
+ * The construction follows XXH3: short inputs are mixed with a 128-bit multiply,
+ * long inputs are consumed in 64-byte stripes by eight independent 32x32->64
+ * multiply-accumulate lanes which the compiler turns into SIMD code,
+ * the accumulators are scrambled every 1 KiB and folded at the end.
+ * The output is NOT compatible with the reference XXH3 implementation.
+ */
+class Hash {
+
+	static constexpr uint64_t PRIME32_1 = 0x9E3779B1u;
+	static constexpr uint64_t PRIME64_1 = 0x9E3779B185EBCA87ull;
+	static constexpr uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4Full;
+	static constexpr uint64_t PRIME64_3 = 0x165667B19E3779F9ull;
+	static constexpr uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ull;
+	static constexpr uint64_t PRIME64_5 = 0x27D4EB2F165667C5ull;
+
+	static constexpr size_t LANES = 8u;
+	static constexpr size_t STRIPE_LEN = LANES * sizeof(uint64_t);
+	static constexpr size_t STRIPES_PER_BLOCK = 16u;
+
+	static constexpr uint64_t SECRET[LANES + 1u] = {
+		0xBE4BA423396CFEB8ull,
+		0x1CAD21F72C81017Cull,
+		0xDB979083E96DD4DEull,
+		0x1F67B3B7A4A44072ull,
+		0x78E5C0CC4EE679CBull,
+		0x2172FFCC7DD05A82ull,
+		0x8E2443F7744608B8ull,
+		0x4C263A81E69035E0ull,
+		0xCB00C391BB52283Cull,
+	};
+
+public:
+
+	static uint64_t hash64(const void* data, size_t len, uint64_t seed = 0) noexcept {
+		const auto str = static_cast<const uint8_t*>(data);
+		if(len <= 16u) {
+			return hash_short(str, len, seed);
+		} else if(len <= 128u) {
+			return hash_medium(str, len, seed);
+		}
+		return hash_long(str, len, seed);
+	}
+
+	/**
+	 * Combines two hash values, the result depends on the order of the arguments.
+	 */
+	static uint64_t combine(uint64_t lhs, uint64_t rhs) noexcept {
+		return avalanche(mul128_fold64(lhs ^ PRIME64_2, rhs ^ PRIME64_3) + lhs);
+	}
+
+	static uint64_t avalanche(uint64_t value) noexcept {
+		value ^= value >> 37u;
+		value *= PRIME64_3;
+		value ^= value >> 32u;
+		return value;
+	}
+
+private:
+
+	static uint64_t read64(const uint8_t* ptr) noexcept {
+		uint64_t result;
+		memcpy(&result, ptr, sizeof(result));
+		return le64toh(result);
+	}
+
+	static uint32_t read32(const uint8_t* ptr) noexcept {
+		uint32_t result;
+		memcpy(&result, ptr, sizeof(result));
+		return le32toh(result);
+	}
+
+	static constexpr uint64_t rotl64(uint64_t value, unsigned bits) noexcept {
+		return (value << bits) | (value >> (64u - bits));
+	}
+
+	static uint64_t mul128_fold64(uint64_t lhs, uint64_t rhs) noexcept {
+		const __uint128_t product = static_cast<__uint128_t>(lhs) * rhs;
+		return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64u);
+	}
+
+	static uint64_t mix16(const uint8_t* ptr, uint64_t secret_lo, uint64_t secret_hi, uint64_t seed) noexcept {
+		return mul128_fold64(read64(ptr) ^ (secret_lo + seed), read64(ptr + 8u) ^ (secret_hi - seed));
+	}
+
+	static uint64_t hash_short(const uint8_t* str, size_t len, uint64_t seed) noexcept {
+		if(len > 8u) {
+			const uint64_t lo = read64(str) ^ ((SECRET[0] ^ SECRET[1]) + seed);
+			const uint64_t hi = read64(str + len - 8u) ^ ((SECRET[2] ^ SECRET[3]) - seed);
+			return avalanche(len + __builtin_bswap64(lo) + hi + mul128_fold64(lo, hi));
+		} else if(len >= 4u) {
+			const uint64_t input = read32(str + len - 4u) + (static_cast<uint64_t>(read32(str)) << 32u);
+			uint64_t value = input ^ ((SECRET[4] ^ SECRET[5]) - seed);
+			value ^= rotl64(value, 49u) ^ rotl64(value, 24u);
+			value *= PRIME64_4;
+			value ^= (value >> 35u) + len;
+			value *= PRIME64_4;
+			return value ^ (value >> 28u);
+		} else if(len > 0) {
+			const uint32_t combined = (uint32_t(str[0]) << 16u) | (uint32_t(str[len >> 1u]) << 24u)
+				| uint32_t(str[len - 1u]) | (uint32_t(len) << 8u);
+			return avalanche(combined ^ ((SECRET[6] & 0xFFFFFFFFu) + seed));
+		}
+		return avalanche(seed ^ SECRET[7] ^ SECRET[8]);
+	}
+
+	static uint64_t hash_medium(const uint8_t* str, size_t len, uint64_t seed) noexcept {
+		uint64_t acc = len * PRIME64_1;
+		size_t offset = 0;
+		size_t secret = 0;
+		while(offset + 16u <= len) {
+			acc += mix16(str + offset, SECRET[secret], SECRET[secret + 1u], seed);
+			secret = (secret + 2u) % LANES;
+			offset += 16u;
+		}
+		acc += mix16(str + len - 16u, SECRET[7], SECRET[8], seed);
+		return avalanche(acc);
+	}
+
+	static void accumulate(uint64_t acc[LANES], const uint8_t* stripe) noexcept {
+		for(size_t i = 0; i < LANES; ++i) {
+			const uint64_t lane = read64(stripe + i * sizeof(uint64_t));
+			const uint64_t key = lane ^ SECRET[i];
+			acc[i ^ 1u] += lane;
+			acc[i] += (key & 0xFFFFFFFFu) * (key >> 32u);
+		}
+	}
+
+	static void scramble(uint64_t acc[LANES]) noexcept {
+		for(size_t i = 0; i < LANES; ++i) {
+			acc[i] ^= acc[i] >> 47u;
+			acc[i] ^= SECRET[i + 1u];
+			acc[i] *= PRIME32_1;
+		}
+	}
+
+	static uint64_t hash_long(const uint8_t* str, size_t len, uint64_t seed) noexcept {
+		uint64_t acc[LANES] = {
+			PRIME32_1 + seed, PRIME64_1, PRIME64_2, PRIME64_3,
+			PRIME64_4 - seed, PRIME32_1, PRIME64_5, PRIME64_1 ^ seed
+		};
+
+		const size_t stripes = (len - 1u) / STRIPE_LEN;
+		for(size_t stripe = 0; stripe < stripes; ++stripe) {
+			accumulate(acc, str + stripe * STRIPE_LEN);
+			if((stripe + 1u) % STRIPES_PER_BLOCK == 0) {
+				scramble(acc);
+			}
+		}
+		// The last stripe always overlaps the end of the input.
+		accumulate(acc, str + len - STRIPE_LEN);
+
+		uint64_t result = len * PRIME64_1;
+		for(size_t i = 0; i < LANES; i += 2u) {
+			result += mul128_fold64(acc[i] ^ SECRET[i], acc[i + 1u] ^ SECRET[i + 1u]);
+		}
+		return avalanche(result);
+	}
+
+};
+
+} // namespace jjson
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace jjson {
+
+/**
+ * Allocator which backs every allocation with 2 MiB pages, use it for the large node pools:
+ *
+ * jjson::DomBuilder<jjson::HugePageAllocator<jjson::Node>> dom(capacity, jjson::HugePageAllocator<jjson::Node>(numa_node));
+ *
+ * The explicit hugetlbfs pages are tried first, if the system has none reserved the allocation
+ * falls back to a 2 MiB aligned anonymous mapping advised for the transparent huge pages,
+ * which itself silently degrades to the regular pages.
+ * If a NUMA node is given the pages are preferably placed on it, the policy is applied before
+ * the first touch, a failed mbind() leaves the default first-touch placement.
+ *
+ * The allocations under MIN_HUGE_ALLOCATION go to the regular heap: a DomBuilder rebinds the allocator
+ * for its stack and its strings too, those small vectors must not take a 2 MiB mapping per growth.
+ */
+template <typename T>
+class HugePageAllocator {
+public:
+
+	using value_type = T;
+
+	static constexpr size_t HUGE_PAGE_SIZE = 2u * 1024u * 1024u;
+	static constexpr int ANY_NODE = -1;
+	/** The smallest allocation on the huge pages, half of a page is wasted at most. */
+	static constexpr size_t MIN_HUGE_ALLOCATION = HUGE_PAGE_SIZE / 2u;
+
+private:
+
+	int _numa_node;
+
+public:
+
+	explicit HugePageAllocator(int numa_node = ANY_NODE) noexcept : _numa_node(numa_node) {}
+
+	template <typename U>
+	HugePageAllocator(const HugePageAllocator<U>& rv) noexcept : _numa_node(rv.numa_node()) {}
+
+	int numa_node() const noexcept {
+		return _numa_node;
+	}
+
+	T* allocate(size_t count) {
+		if(is_small(count)) {
+			return static_cast<T*>(::operator new(count * sizeof(T)));
+		}
+		const size_t len = mapping_size(count);
+		void* result = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (21 << MAP_HUGE_SHIFT), -1, 0);
+		if(result == MAP_FAILED) {
+			result = map_aligned(len);
+			if(result == nullptr) {
+				throw std::bad_alloc();
+			}
+			madvise(result, len, MADV_HUGEPAGE);
+		}
+		bind(result, len);
+		return static_cast<T*>(result);
+	}
+
+	void deallocate(T* ptr, size_t count) noexcept {
+		if(ptr == nullptr) {
+			return;
+		}
+		if(is_small(count)) {
+			::operator delete(ptr);
+		} else {
+			munmap(ptr, mapping_size(count));
+		}
+	}
+
+	template <typename U>
+	bool operator==(const HugePageAllocator<U>&) const noexcept {
+		// Any instance can release the memory of another one.
+		return true;
+	}
+
+	template <typename U>
+	bool operator!=(const HugePageAllocator<U>& rv) const noexcept {
+		return not (*this == rv);
+	}
+
+private:
+
+	static bool is_small(size_t count) noexcept {
+		return count * sizeof(T) < MIN_HUGE_ALLOCATION;
+	}
+
+	static size_t mapping_size(size_t count) noexcept {
+		const size_t bytes = count * sizeof(T);
+		return (bytes + HUGE_PAGE_SIZE - 1u) & ~(HUGE_PAGE_SIZE - 1u);
+	}
+
+	/**
+	 * The transparent huge pages need a 2 MiB aligned range, so the mapping is over-allocated and trimmed.
+	 */
+	static void* map_aligned(size_t len) noexcept {
+		const size_t mapped_len = len + HUGE_PAGE_SIZE;
+		void* mapped = mmap(nullptr, mapped_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(mapped == MAP_FAILED) {
+			return nullptr;
+		}
+		const auto begin = reinterpret_cast<uintptr_t>(mapped);
+		const auto aligned = (begin + HUGE_PAGE_SIZE - 1u) & ~uintptr_t(HUGE_PAGE_SIZE - 1u);
+		const size_t head = aligned - begin;
+		const size_t tail = mapped_len - head - len;
+		if(head) {
+			munmap(mapped, head);
+		}
+		if(tail) {
+			munmap(reinterpret_cast<void*>(aligned + len), tail);
+		}
+		return reinterpret_cast<void*>(aligned);
+	}
+
+	void bind(void* ptr, size_t len) const noexcept {
+		static constexpr size_t MASK_BITS = sizeof(unsigned long) * 8u;
+		if(_numa_node >= 0 && size_t(_numa_node) < MASK_BITS) {
+			const unsigned long node_mask = 1ul << unsigned(_numa_node);
+			// The kernel reads 'maxnode - 1' bits of the mask.
+			syscall(SYS_mbind, ptr, len, MPOL_PREFERRED, &node_mask, MASK_BITS + 1u, 0);
+		}
+	}
+
+};
+
+} // namespace jjson
@@ -0,0 +1,371 @@
+#pragma once
+
+#include <lib/jjson/Escape.h>
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace jjson {
+
+/**
+ * An object key escaped at compile time, together with its quotes and the ':'.
+ *
+ * static constexpr jjson::JsonKey NAME("name");
+ * writer.key(NAME);
+ */
+template <size_t N>
+class JsonKey {
+
+	char _data[(N - 1u) * Escape::MAX_SEQUENCE + 3u] = {};
+	size_t _size = 0;
+
+public:
+
+	constexpr JsonKey(const char (&key)[N]) noexcept {
+		_data[_size++] = '"';
+		for(size_t i = 0; i + 1u < N; ++i) {
+			const auto c = uint8_t(key[i]);
+			if(Escape::needs_escape(c)) {
+				_size = Escape::write_sequence(_data + _size, c) - _data;
+			} else {
+				_data[_size++] = key[i];
+			}
+		}
+		_data[_size++] = '"';
+		_data[_size++] = ':';
+	}
+
+	constexpr std::string_view view() const noexcept {
+		return std::string_view(_data, _size);
+	}
+
+};
+
+/**
+ * Writes a JSON document from the application values.
+ *
+ * The output is either a growable buffer owned by the writer or a fixed buffer of the caller.
+ * A write which does not fit the fixed buffer sets overflow() and drops the rest of the document,
+ * so the output never ends in the middle of a token.
+ * The separators are put by the writer, the nesting is not checked: the caller pairs begin and end
+ * and puts a key before every value of an object.
+ */
+class JsonWriter {
+
+	static constexpr char DIGIT_PAIRS[] =
+		"00010203040506070809"
+		"10111213141516171819"
+		"20212223242526272829"
+		"30313233343536373839"
+		"40414243444546474849"
+		"50515253545556575859"
+		"60616263646566676869"
+		"70717273747576777879"
+		"80818283848586878889"
+		"90919293949596979899";
+
+	static constexpr uint64_t POW10[] = {
+		1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull,
+		1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull,
+		100000000000000ull, 1000000000000000ull, 10000000000000000ull, 100000000000000000ull,
+		1000000000000000000ull, 10000000000000000000ull
+	};
+
+	/** The longest double in the shortest form fits. */
+	static constexpr size_t MAX_NUMBER = 32u;
+
+	std::string _buffer;
+	char* _data;
+	size_t _size;
+	size_t _capacity;
+	bool _fixed;
+	bool _overflow;
+	bool _need_comma;
+
+public:
+
+	JsonWriter(const JsonWriter&) = delete;
+	JsonWriter& operator=(const JsonWriter&) = delete;
+
+	JsonWriter(JsonWriter&& rv) = delete;
+	JsonWriter& operator=(JsonWriter&&) = delete;
+
+	/**
+	 * The growable output.
+	 */
+	JsonWriter() noexcept :
+		_data(nullptr), _size(0), _capacity(0), _fixed(false), _overflow(false), _need_comma(false) {}
+
+	/**
+	 * The fixed output, the buffer is not owned.
+	 */
+	JsonWriter(char* buffer, size_t capacity) noexcept :
+		_data(buffer), _size(0), _capacity(capacity), _fixed(true), _overflow(false), _need_comma(false) {}
+
+	std::string_view output() const noexcept {
+		return std::string_view(_data, _size);
+	}
+
+	size_t size() const noexcept {
+		return _size;
+	}
+
+	/**
+	 * @return true if the document has not fit the fixed buffer, the output is its prefix.
+	 */
+	bool overflow() const noexcept {
+		return _overflow;
+	}
+
+	/**
+	 * Starts a new document, the growable buffer is kept.
+	 */
+	void clear() noexcept {
+		_size = 0;
+		_overflow = false;
+		_need_comma = false;
+	}
+
+	void begin_object() {
+		put_token('{');
+	}
+
+	void end_object() {
+		end_token('}');
+	}
+
+	void begin_array() {
+		put_token('[');
+	}
+
+	void end_array() {
+		end_token(']');
+	}
+
+	/**
+	 * @param name - the raw key, it is escaped.
+	 */
+	void key(std::string_view name) {
+		const size_t start = _size;
+		string(name);
+		if(_overflow) {
+			return;
+		}
+		if(not reserve(1u)) {
+			_size = start;
+			return;
+		}
+		_data[_size++] = ':';
+		_need_comma = false;
+	}
+
+	template <size_t N>
+	void key(const JsonKey<N>& name) {
+		const std::string_view data = name.view();
+		if(reserve_item(data.size())) {
+			put_comma();
+			memcpy(_data + _size, data.data(), data.size());
+			_size += data.size();
+		}
+		_need_comma = false;
+	}
+
+	/**
+	 * @param text - the raw text, it is escaped.
+	 */
+	void value(std::string_view text) {
+		string(text);
+	}
+
+	void value(const char* text) {
+		string(text);
+	}
+
+	void value(bool flag) {
+		raw(flag ? std::string_view("true") : std::string_view("false"));
+	}
+
+	template <typename T>
+	std::enable_if_t<std::is_integral_v<T> && not std::is_same_v<T, bool> > value(T number) {
+		bool negative = false;
+		uint64_t magnitude = uint64_t(number);
+		if constexpr (std::is_signed_v<T>) {
+			if(number < 0) {
+				negative = true;
+				// The negation of INT64_MIN fits uint64_t.
+				magnitude = uint64_t(0) - uint64_t(number);
+			}
+		}
+		if(not reserve_item(digit_count(magnitude) + negative)) {
+			return;
+		}
+		put_comma();
+		char* out = _data + _size;
+		if(negative) {
+			*out++ = '-';
+		}
+		_size = write_uint(out, magnitude) - _data;
+		_need_comma = true;
+	}
+
+	/**
+	 * The shortest representation which reads back to the same double.
+	 * NaN and infinity have no JSON form, they are written as null.
+	 */
+	void value(double number) {
+		if(not std::isfinite(number)) {
+			null();
+			return;
+		}
+		char buffer[MAX_NUMBER];
+		const auto result = std::to_chars(buffer, buffer + MAX_NUMBER, number);
+		raw(std::string_view(buffer, result.ptr - buffer));
+	}
+
+	void null() {
+		raw("null");
+	}
+
+	/**
+	 * Writes a value which is JSON already, e.g. a Node::data of a number.
+	 */
+	void raw(std::string_view json) {
+		if(not reserve_item(json.size())) {
+			return;
+		}
+		put_comma();
+		memcpy(_data + _size, json.data(), json.size());
+		_size += json.size();
+		_need_comma = true;
+	}
+
+	/**
+	 * Writes the decimal digits of the number from the end, two digits a step.
+	 * The division by the constant 100 is a multiplication, there is no loop over the single digits.
+	 * @return The end of the written digits.
+	 */
+	static char* write_uint(char* out, uint64_t number) noexcept {
+		char* end = out + digit_count(number);
+		char* p = end;
+		while(number >= 100u) {
+			const size_t pair = size_t(number % 100u) * 2u;
+			number /= 100u;
+			p -= 2;
+			p[0] = DIGIT_PAIRS[pair];
+			p[1] = DIGIT_PAIRS[pair + 1u];
+		}
+		if(number >= 10u) {
+			p -= 2;
+			p[0] = DIGIT_PAIRS[number * 2u];
+			p[1] = DIGIT_PAIRS[number * 2u + 1u];
+		} else {
+			*--p = char('0' + number);
+		}
+		return end;
+	}
+
+	/**
+	 * The number of the decimal digits from the bit length: log10(2) ~ 1233 / 4096.
+	 */
+	static size_t digit_count(uint64_t number) noexcept {
+		const unsigned bits = 64u - unsigned(__builtin_clzll(number | 1u));
+		const size_t digits = (bits * 1233u) >> 12u;
+		return number >= POW10[digits] ? digits + 1u : (digits ? digits : 1u);
+	}
+
+private:
+
+	/**
+	 * Makes room for 'size' bytes, the fixed output fails for the rest of the document.
+	 */
+	bool reserve(size_t size) {
+		const size_t required = _size + size;
+		if(_overflow) {
+			return false;
+		}
+		if(required <= _capacity) {
+			return true;
+		}
+		if(_fixed) {
+			_overflow = true;
+			return false;
+		}
+		const size_t capacity = required > _capacity * 2u ? required : _capacity * 2u;
+		_buffer.resize(capacity);
+		_data = _buffer.data();
+		_capacity = capacity;
+		return true;
+	}
+
+	/**
+	 * Makes room for an item of 'size' bytes after the comma if it is needed.
+	 */
+	bool reserve_item(size_t size) {
+		return reserve(size + (_need_comma ? 1u : 0u));
+	}
+
+	void put_comma() noexcept {
+		if(_need_comma) {
+			_data[_size++] = ',';
+		}
+	}
+
+	void put_token(char token) {
+		if(reserve_item(1u)) {
+			put_comma();
+			_data[_size++] = token;
+		}
+		_need_comma = false;
+	}
+
+	void end_token(char token) {
+		if(reserve(1u)) {
+			_data[_size++] = token;
+		}
+		_need_comma = true;
+	}
+
+	/**
+	 * The runs which need no escapes are copied as blocks, see Escape::plain_prefix().
+	 * A string which does not fit is dropped as a whole.
+	 */
+	void string(std::string_view text) {
+		const size_t start = _size;
+		if(not reserve_item(text.size() + 2u)) {
+			return;
+		}
+		put_comma();
+		_data[_size++] = '"';
+		while(true) {
+			const size_t plain = Escape::plain_prefix(text.data(), text.size());
+			if(not reserve(plain + 1u)) {
+				_size = start;
+				return;
+			}
+			if(plain) {
+				memcpy(_data + _size, text.data(), plain);
+				_size += plain;
+			}
+			text.remove_prefix(plain);
+			if(text.empty()) {
+				break;
+			}
+			if(not reserve((Escape::sequence(uint8_t(text[0])) ? 2u : Escape::MAX_SEQUENCE) + 1u)) {
+				_size = start;
+				return;
+			}
+			_size = Escape::write_sequence(_data + _size, uint8_t(text[0])) - _data;
+			text.remove_prefix(1u);
+		}
+		_data[_size++] = '"';
+		_need_comma = true;
+	}
+
+};
+
+} // namespace jjson
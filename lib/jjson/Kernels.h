@@ -0,0 +1,802 @@
+#pragma once
+
+#include <lib/jjson/CpuFeatures.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace jjson {
+
+/**
+ * The hot scanners bound once to the best instruction set of the CPU, see CpuFeatures::select().
+ *
+ * A scanner or a searcher reads only [p, end) and returns 'end' if it finds nothing,
+ * the vector tiers finish the tail shorter than a vector with the scalar code.
+ * The x86 kernels are compiled with the target attributes, the rest of the code needs no -m flags.
+ */
+struct Kernels {
+
+	using Scanner = const uint8_t* (*)(const uint8_t* p, const uint8_t* end);
+	using Searcher = const uint8_t* (*)(const uint8_t* p, const uint8_t* end, const uint8_t* needle, size_t size);
+
+	CpuTier tier;
+	/** The first '"', '\' or control character. */
+	Scanner find_escape;
+	/** The first '"', '{', '}', '[' or ']'. */
+	Scanner find_structural;
+	/** The first byte which is not ' ', '\t', '\n' or '\r'. */
+	Scanner skip_whitespace;
+	/** The first byte of the first invalid or truncated UTF-8 sequence. */
+	Scanner validate_utf8;
+	/** The first occurrence of the needle. */
+	Searcher find_substring;
+
+	/**
+	 * @return The kernels of CpuFeatures::select(), chosen on the first call.
+	 */
+	static const Kernels& get() noexcept {
+		static const Kernels kernels = for_tier(CpuFeatures::select());
+		return kernels;
+	}
+
+	/**
+	 * @return The kernels of the tier, the scalar ones if it is not built for this architecture.
+	 * The caller checks CpuFeatures::supports().
+	 */
+	static Kernels for_tier(CpuTier tier) noexcept;
+
+};
+
+/**
+ * The portable fallback.
+ */
+struct ScalarKernels {
+
+	static const uint8_t* find_escape(const uint8_t* p, const uint8_t* end) noexcept {
+		while(p < end && *p >= 0x20u && *p != '"' && *p != '\\') {
+			p++;
+		}
+		return p;
+	}
+
+	static const uint8_t* find_structural(const uint8_t* p, const uint8_t* end) noexcept {
+		while(p < end) {
+			switch(*p) {
+				case '"':
+				case '{':
+				case '}':
+				case '[':
+				case ']':
+					return p;
+
+				default:
+					p++;
+					break;
+			}
+		}
+		return p;
+	}
+
+	static const uint8_t* skip_whitespace(const uint8_t* p, const uint8_t* end) noexcept {
+		while(p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+			p++;
+		}
+		return p;
+	}
+
+	/**
+	 * A sequence at a time: no overlong forms, no surrogates, at most U+10FFFF.
+	 */
+	static const uint8_t* validate_utf8(const uint8_t* p, const uint8_t* end) noexcept {
+		while(p < end) {
+			const uint8_t c = *p;
+			if(c < 0x80u) {
+				p++;
+				continue;
+			}
+			size_t len;
+			uint8_t min = 0x80u;
+			uint8_t max = 0xBFu;
+			if(c >= 0xC2u && c <= 0xDFu) {
+				len = 2u;
+			} else if(c >= 0xE0u && c <= 0xEFu) {
+				len = 3u;
+				if(c == 0xE0u) {
+					min = 0xA0u;
+				} else if(c == 0xEDu) {
+					max = 0x9Fu;
+				}
+			} else if(c >= 0xF0u && c <= 0xF4u) {
+				len = 4u;
+				if(c == 0xF0u) {
+					min = 0x90u;
+				} else if(c == 0xF4u) {
+					max = 0x8Fu;
+				}
+			} else {
+				return p;
+			}
+			if(size_t(end - p) < len || p[1] < min || p[1] > max) {
+				return p;
+			}
+			for(size_t i = 2u; i < len; ++i) {
+				if((p[i] & 0xC0u) != 0x80u) {
+					return p;
+				}
+			}
+			p += len;
+		}
+		return p;
+	}
+
+
+	static const uint8_t* find_substring(const uint8_t* p, const uint8_t* end, const uint8_t* needle, size_t size) noexcept {
+		const auto found = static_cast<const uint8_t*>(memmem(p, end - p, needle, size));
+		return found ? found : end;
+	}
+
+};
+
+/**
+ * The tables of the vector UTF-8 validation, "Validating UTF-8 In Less Than One Instruction Per Byte",
+ * J. Keiser, D. Lemire. A byte pair is looked up by the high and the low nibble of the first byte
+ * and the high nibble of the second one, an error is a bit set in all three.
+ */
+struct Utf8Tables {
+
+	static constexpr uint8_t TOO_SHORT = 1u << 0u;
+	static constexpr uint8_t TOO_LONG = 1u << 1u;
+	static constexpr uint8_t OVERLONG_3 = 1u << 2u;
+	static constexpr uint8_t TOO_LARGE = 1u << 3u;
+	static constexpr uint8_t SURROGATE = 1u << 4u;
+	static constexpr uint8_t OVERLONG_2 = 1u << 5u;
+	static constexpr uint8_t TOO_LARGE_1000 = 1u << 6u;
+	static constexpr uint8_t OVERLONG_4 = 1u << 6u;
+	static constexpr uint8_t TWO_CONTS = 1u << 7u;
+	static constexpr uint8_t CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+	static constexpr uint8_t BYTE_1_HIGH[16] = {
+		// 0_______ ASCII
+		TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+		// 10______ continuation
+		TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+		// 1100____ two byte lead
+		TOO_SHORT | OVERLONG_2,
+		// 1101____ two byte lead
+		TOO_SHORT,
+		// 1110____ three byte lead
+		TOO_SHORT | OVERLONG_3 | SURROGATE,
+		// 1111____ four byte lead
+		TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4
+	};
+
+	static constexpr uint8_t BYTE_1_LOW[16] = {
+		// ____0000
+		CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+		// ____0001
+		CARRY | OVERLONG_2,
+		// ____001_
+		CARRY, CARRY,
+		// ____0100
+		CARRY | TOO_LARGE,
+		// ____0101 .. ____1100
+		CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+		// ____1101
+		CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+		// ____111_
+		CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000
+	};
+
+	static constexpr uint8_t BYTE_2_HIGH[16] = {
+		// 0_______ ASCII
+		TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+		// 1000____
+		TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+		// 1001____
+		TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+		// 101_____
+		TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+		TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+		// 11______
+		TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT
+	};
+
+	/**
+	 * The last bytes of a block which start a sequence longer than the rest of the block.
+	 * A byte is over the limit at the positions 3, 2 and 1 from the end.
+	 */
+	static constexpr uint8_t INCOMPLETE_3[3] = {0xF0u - 1u, 0xE0u - 1u, 0xC0u - 1u};
+
+};
+
+#if defined(__x86_64__) || defined(__i386__)
+
+struct Sse42Kernels {
+
+	static constexpr size_t WIDTH = 16u;
+
+	__attribute__((target("sse4.2")))
+	static const uint8_t* find_escape(const uint8_t* p, const uint8_t* end) noexcept {
+		const __m128i quote = _mm_set1_epi8('"');
+		const __m128i backslash = _mm_set1_epi8('\\');
+		const __m128i control = _mm_set1_epi8(0x1F);
+		for(; end - p >= ptrdiff_t(WIDTH); p += WIDTH) {
+			const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			// c <= 0x1F unsigned iff min(c, 0x1F) == c.
+			const __m128i special = _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash)),
+				_mm_cmpeq_epi8(_mm_min_epu8(block, control), block));
+			const unsigned mask = unsigned(_mm_movemask_epi8(special));
+			if(mask) {
+				return p + __builtin_ctz(mask);
+			}
+		}
+		return ScalarKernels::find_escape(p, end);
+	}
+
+	__attribute__((target("sse4.2")))
+	static const uint8_t* find_structural(const uint8_t* p, const uint8_t* end) noexcept {
+		const __m128i quote = _mm_set1_epi8('"');
+		// '[' ']' '{' '}' with the bit 0x20 set are '{' and '}'.
+		const __m128i case_bit = _mm_set1_epi8(0x20);
+		const __m128i open = _mm_set1_epi8('{');
+		const __m128i close = _mm_set1_epi8('}');
+		for(; end - p >= ptrdiff_t(WIDTH); p += WIDTH) {
+			const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			const __m128i folded = _mm_or_si128(block, case_bit);
+			const __m128i special = _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(folded, open), _mm_cmpeq_epi8(folded, close)),
+				_mm_cmpeq_epi8(block, quote));
+			const unsigned mask = unsigned(_mm_movemask_epi8(special));
+			if(mask) {
+				return p + __builtin_ctz(mask);
+			}
+		}
+		return ScalarKernels::find_structural(p, end);
+	}
+
+	__attribute__((target("sse4.2")))
+	static const uint8_t* skip_whitespace(const uint8_t* p, const uint8_t* end) noexcept {
+		const __m128i space = _mm_set1_epi8(' ');
+		const __m128i tab = _mm_set1_epi8('\t');
+		const __m128i lf = _mm_set1_epi8('\n');
+		const __m128i cr = _mm_set1_epi8('\r');
+		for(; end - p >= ptrdiff_t(WIDTH); p += WIDTH) {
+			const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			const __m128i ws = _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, tab)),
+				_mm_or_si128(_mm_cmpeq_epi8(block, lf), _mm_cmpeq_epi8(block, cr)));
+			const unsigned mask = ~unsigned(_mm_movemask_epi8(ws)) & 0xFFFFu;
+			if(mask) {
+				return p + __builtin_ctz(mask);
+			}
+		}
+		return ScalarKernels::skip_whitespace(p, end);
+	}
+
+	__attribute__((target("sse4.2")))
+	static __m128i utf8_errors(__m128i input, __m128i prev) noexcept {
+		const __m128i nibble = _mm_set1_epi8(0x0F);
+		const __m128i byte_1_high_table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Utf8Tables::BYTE_1_HIGH));
+		const __m128i byte_1_low_table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Utf8Tables::BYTE_1_LOW));
+		const __m128i byte_2_high_table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Utf8Tables::BYTE_2_HIGH));
+
+		const __m128i prev1 = _mm_alignr_epi8(input, prev, 15);
+		const __m128i byte_1_high = _mm_shuffle_epi8(byte_1_high_table, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble));
+		const __m128i byte_1_low = _mm_shuffle_epi8(byte_1_low_table, _mm_and_si128(prev1, nibble));
+		const __m128i byte_2_high = _mm_shuffle_epi8(byte_2_high_table, _mm_and_si128(_mm_srli_epi16(input, 4), nibble));
+		const __m128i special = _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+
+		// The third and the fourth bytes of a sequence must be the continuations, TWO_CONTS marks them.
+		const __m128i prev2 = _mm_alignr_epi8(input, prev, 14);
+		const __m128i prev3 = _mm_alignr_epi8(input, prev, 13);
+		const __m128i third = _mm_subs_epu8(prev2, _mm_set1_epi8(char(0xE0u - 0x80u)));
+		const __m128i fourth = _mm_subs_epu8(prev3, _mm_set1_epi8(char(0xF0u - 0x80u)));
+		const __m128i must_continue = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8(char(0x80u)));
+		return _mm_xor_si128(must_continue, special);
+	}
+
+	__attribute__((target("sse4.2")))
+	static __m128i utf8_incomplete(__m128i input) noexcept {
+		const __m128i limit = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+			char(Utf8Tables::INCOMPLETE_3[0]), char(Utf8Tables::INCOMPLETE_3[1]), char(Utf8Tables::INCOMPLETE_3[2]));
+		return _mm_subs_epu8(input, limit);
+	}
+
+	/**
+	 * The ASCII blocks are skipped, the position of an error is found again by the scalar code.
+	 */
+	__attribute__((target("sse4.2")))
+	static const uint8_t* validate_utf8(const uint8_t* begin, const uint8_t* end) noexcept {
+		const uint8_t* p = begin;
+		__m128i prev = _mm_setzero_si128();
+		__m128i incomplete = _mm_setzero_si128();
+		__m128i error = _mm_setzero_si128();
+		uint8_t tail[WIDTH];
+		while(p < end) {
+			__m128i input;
+			if(end - p >= ptrdiff_t(WIDTH)) {
+				input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			} else {
+				memset(tail, 0, WIDTH);
+				memcpy(tail, p, end - p);
+				input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tail));
+			}
+			if(_mm_movemask_epi8(input) == 0) {
+				error = _mm_or_si128(error, incomplete);
+				incomplete = _mm_setzero_si128();
+			} else {
+				error = _mm_or_si128(error, utf8_errors(input, prev));
+				incomplete = utf8_incomplete(input);
+			}
+			if(not _mm_testz_si128(error, error)) {
+				return ScalarKernels::validate_utf8(begin, end);
+			}
+			prev = input;
+			p += WIDTH;
+		}
+		if(not _mm_testz_si128(incomplete, incomplete)) {
+			return ScalarKernels::validate_utf8(begin, end);
+		}
+		return end;
+	}
+
+
+	/**
+	 * "SIMD-friendly algorithms for substring searching", W. Mula: the candidates of a block are the starts
+	 * where both the first and the last bytes of the needle match, only they are compared in full.
+	 */
+	__attribute__((target("sse4.2")))
+	static const uint8_t* find_substring(const uint8_t* p, const uint8_t* end, const uint8_t* needle, size_t size) noexcept {
+		if(size < 2u) {
+			return ScalarKernels::find_substring(p, end, needle, size);
+		}
+		const __m128i first = _mm_set1_epi8(char(needle[0]));
+		const __m128i last = _mm_set1_epi8(char(needle[size - 1u]));
+		// A block of the starts which leave room for the whole needle.
+		for(; end - p >= ptrdiff_t(size - 1u + WIDTH); p += WIDTH) {
+			const __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			const __m128i block_last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + size - 1u));
+			unsigned mask = unsigned(_mm_movemask_epi8(
+				_mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last))));
+			while(mask) {
+				const unsigned offset = __builtin_ctz(mask);
+				if(memcmp(p + offset + 1u, needle + 1u, size - 2u) == 0) {
+					return p + offset;
+				}
+				mask &= mask - 1u;
+			}
+		}
+		return ScalarKernels::find_substring(p, end, needle, size);
+	}
+
+};
+
+struct Avx2Kernels {
+
+	static constexpr size_t WIDTH = 32u;
+
+	__attribute__((target("avx2")))
+	static const uint8_t* find_escape(const uint8_t* p, const uint8_t* end) noexcept {
+		const __m256i quote = _mm256_set1_epi8('"');
+		const __m256i backslash = _mm256_set1_epi8('\\');
+		const __m256i control = _mm256_set1_epi8(0x1F);
+		for(; end - p >= ptrdiff_t(WIDTH); p += WIDTH) {
+			const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+			const __m256i special = _mm256_or_si256(
+				_mm256_or_si256(_mm256_cmpeq_epi8(block, quote), _mm256_cmpeq_epi8(block, backslash)),
+				_mm256_cmpeq_epi8(_mm256_min_epu8(block, control), block));
+			const unsigned mask = unsigned(_mm256_movemask_epi8(special));
+			if(mask) {
+				return p + __builtin_ctz(mask);
+			}
+		}
+		return Sse42Kernels::find_escape(p, end);
+	}
+
+	__attribute__((target("avx2")))
+	static const uint8_t* find_structural(const uint8_t* p, const uint8_t* end) noexcept {
+		const __m256i quote = _mm256_set1_epi8('"');
+		const __m256i case_bit = _mm256_set1_epi8(0x20);
+		const __m256i open = _mm256_set1_epi8('{');
+		const __m256i close = _mm256_set1_epi8('}');
+		for(; end - p >= ptrdiff_t(WIDTH); p += WIDTH) {
+			const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+			const __m256i folded = _mm256_or_si256(block, case_bit);
+			const __m256i special = _mm256_or_si256(
+				_mm256_or_si256(_mm256_cmpeq_epi8(folded, open), _mm256_cmpeq_epi8(folded, close)),
+				_mm256_cmpeq_epi8(block, quote));
+			const unsigned mask = unsigned(_mm256_movemask_epi8(special));
+			if(mask) {
+				return p + __builtin_ctz(mask);
+			}
+		}
+		return Sse42Kernels::find_structural(p, end);
+	}
+
+	__attribute__((target("avx2")))
+	static const uint8_t* skip_whitespace(const uint8_t* p, const uint8_t* end) noexcept {
+		const __m256i space = _mm256_set1_epi8(' ');
+		const __m256i tab = _mm256_set1_epi8('\t');
+		const __m256i lf = _mm256_set1_epi8('\n');
+		const __m256i cr = _mm256_set1_epi8('\r');
+		for(; end - p >= ptrdiff_t(WIDTH); p += WIDTH) {
+			const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+			const __m256i ws = _mm256_or_si256(
+				_mm256_or_si256(_mm256_cmpeq_epi8(block, space), _mm256_cmpeq_epi8(block, tab)),
+				_mm256_or_si256(_mm256_cmpeq_epi8(block, lf), _mm256_cmpeq_epi8(block, cr)));
+			const unsigned mask = ~unsigned(_mm256_movemask_epi8(ws));
+			if(mask) {
+				return p + __builtin_ctz(mask);
+			}
+		}
+		return Sse42Kernels::skip_whitespace(p, end);
+	}
+
+	/**
+	 * The bytes of the input shifted by N, the first N bytes come from the end of prev.
+	 */
+	template <int N>
+	__attribute__((target("avx2")))
+	static __m256i previous(__m256i input, __m256i prev) noexcept {
+		return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev, input, 0x21), 16 - N);
+	}
+
+	__attribute__((target("avx2")))
+	static __m256i table(const uint8_t* values) noexcept {
+		return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values)));
+	}
+
+	__attribute__((target("avx2")))
+	static __m256i utf8_errors(__m256i input, __m256i prev) noexcept {
+		const __m256i nibble = _mm256_set1_epi8(0x0F);
+		const __m256i prev1 = previous<1>(input, prev);
+		const __m256i byte_1_high = _mm256_shuffle_epi8(table(Utf8Tables::BYTE_1_HIGH),
+			_mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+		const __m256i byte_1_low = _mm256_shuffle_epi8(table(Utf8Tables::BYTE_1_LOW), _mm256_and_si256(prev1, nibble));
+		const __m256i byte_2_high = _mm256_shuffle_epi8(table(Utf8Tables::BYTE_2_HIGH),
+			_mm256_and_si256(_mm256_srli_epi16(input, 4), nibble));
+		const __m256i special = _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+
+		const __m256i third = _mm256_subs_epu8(previous<2>(input, prev), _mm256_set1_epi8(char(0xE0u - 0x80u)));
+		const __m256i fourth = _mm256_subs_epu8(previous<3>(input, prev), _mm256_set1_epi8(char(0xF0u - 0x80u)));
+		const __m256i must_continue = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8(char(0x80u)));
+		return _mm256_xor_si256(must_continue, special);
+	}
+
+	__attribute__((target("avx2")))
+	static __m256i utf8_incomplete(__m256i input) noexcept {
+		const __m256i limit = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+			-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+			char(Utf8Tables::INCOMPLETE_3[0]), char(Utf8Tables::INCOMPLETE_3[1]), char(Utf8Tables::INCOMPLETE_3[2]));
+		return _mm256_subs_epu8(input, limit);
+	}
+
+	__attribute__((target("avx2")))
+	static const uint8_t* validate_utf8(const uint8_t* begin, const uint8_t* end) noexcept {
+		const uint8_t* p = begin;
+		__m256i prev = _mm256_setzero_si256();
+		__m256i incomplete = _mm256_setzero_si256();
+		__m256i error = _mm256_setzero_si256();
+		uint8_t tail[WIDTH];
+		while(p < end) {
+			__m256i input;
+			if(end - p >= ptrdiff_t(WIDTH)) {
+				input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+			} else {
+				memset(tail, 0, WIDTH);
+				memcpy(tail, p, end - p);
+				input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tail));
+			}
+			if(_mm256_movemask_epi8(input) == 0) {
+				error = _mm256_or_si256(error, incomplete);
+				incomplete = _mm256_setzero_si256();
+			} else {
+				error = _mm256_or_si256(error, utf8_errors(input, prev));
+				incomplete = utf8_incomplete(input);
+			}
+			if(not _mm256_testz_si256(error, error)) {
+				return ScalarKernels::validate_utf8(begin, end);
+			}
+			prev = input;
+			p += WIDTH;
+		}
+		if(not _mm256_testz_si256(incomplete, incomplete)) {
+			return ScalarKernels::validate_utf8(begin, end);
+		}
+		return end;
+	}
+
+
+	__attribute__((target("avx2")))
+	static const uint8_t* find_substring(const uint8_t* p, const uint8_t* end, const uint8_t* needle, size_t size) noexcept {
+		if(size < 2u) {
+			return ScalarKernels::find_substring(p, end, needle, size);
+		}
+		const __m256i first = _mm256_set1_epi8(char(needle[0]));
+		const __m256i last = _mm256_set1_epi8(char(needle[size - 1u]));
+		for(; end - p >= ptrdiff_t(size - 1u + WIDTH); p += WIDTH) {
+			const __m256i block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+			const __m256i block_last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + size - 1u));
+			unsigned mask = unsigned(_mm256_movemask_epi8(
+				_mm256_and_si256(_mm256_cmpeq_epi8(block_first, first), _mm256_cmpeq_epi8(block_last, last))));
+			while(mask) {
+				const unsigned offset = __builtin_ctz(mask);
+				if(memcmp(p + offset + 1u, needle + 1u, size - 2u) == 0) {
+					return p + offset;
+				}
+				mask &= mask - 1u;
+			}
+		}
+		return Sse42Kernels::find_substring(p, end, needle, size);
+	}
+
+};
+
+/**
+ * The 64 byte scanners with the mask registers, the UTF-8 validation is the AVX2 one:
+ * the byte shifts across the 128 bit lanes cost more than the wider blocks save.
+ */
+struct Avx512Kernels {
+
+	static constexpr size_t WIDTH = 64u;
+
+	__attribute__((target("avx512f,avx512bw")))
+	static const uint8_t* find_escape(const uint8_t* p, const uint8_t* end) noexcept {
+		const __m512i quote = _mm512_set1_epi8('"');
+		const __m512i backslash = _mm512_set1_epi8('\\');
+		const __m512i control = _mm512_set1_epi8(0x20);
+		for(; end - p >= ptrdiff_t(WIDTH); p += WIDTH) {
+			const __m512i block = _mm512_loadu_si512(p);
+			const uint64_t mask = _mm512_cmpeq_epi8_mask(block, quote) | _mm512_cmpeq_epi8_mask(block, backslash)
+				| _mm512_cmplt_epu8_mask(block, control);
+			if(mask) {
+				return p + __builtin_ctzll(mask);
+			}
+		}
+		return Avx2Kernels::find_escape(p, end);
+	}
+
+	__attribute__((target("avx512f,avx512bw")))
+	static const uint8_t* find_structural(const uint8_t* p, const uint8_t* end) noexcept {
+		const __m512i quote = _mm512_set1_epi8('"');
+		const __m512i case_bit = _mm512_set1_epi8(0x20);
+		const __m512i open = _mm512_set1_epi8('{');
+		const __m512i close = _mm512_set1_epi8('}');
+		for(; end - p >= ptrdiff_t(WIDTH); p += WIDTH) {
+			const __m512i block = _mm512_loadu_si512(p);
+			const __m512i folded = _mm512_or_si512(block, case_bit);
+			const uint64_t mask = _mm512_cmpeq_epi8_mask(folded, open) | _mm512_cmpeq_epi8_mask(folded, close)
+				| _mm512_cmpeq_epi8_mask(block, quote);
+			if(mask) {
+				return p + __builtin_ctzll(mask);
+			}
+		}
+		return Avx2Kernels::find_structural(p, end);
+	}
+
+	__attribute__((target("avx512f,avx512bw")))
+	static const uint8_t* skip_whitespace(const uint8_t* p, const uint8_t* end) noexcept {
+		const __m512i space = _mm512_set1_epi8(' ');
+		const __m512i tab = _mm512_set1_epi8('\t');
+		const __m512i lf = _mm512_set1_epi8('\n');
+		const __m512i cr = _mm512_set1_epi8('\r');
+		for(; end - p >= ptrdiff_t(WIDTH); p += WIDTH) {
+			const __m512i block = _mm512_loadu_si512(p);
+			const uint64_t mask = ~(_mm512_cmpeq_epi8_mask(block, space) | _mm512_cmpeq_epi8_mask(block, tab)
+				| _mm512_cmpeq_epi8_mask(block, lf) | _mm512_cmpeq_epi8_mask(block, cr));
+			if(mask) {
+				return p + __builtin_ctzll(mask);
+			}
+		}
+		return Avx2Kernels::skip_whitespace(p, end);
+	}
+
+
+	__attribute__((target("avx512f,avx512bw")))
+	static const uint8_t* find_substring(const uint8_t* p, const uint8_t* end, const uint8_t* needle, size_t size) noexcept {
+		if(size < 2u) {
+			return ScalarKernels::find_substring(p, end, needle, size);
+		}
+		const __m512i first = _mm512_set1_epi8(char(needle[0]));
+		const __m512i last = _mm512_set1_epi8(char(needle[size - 1u]));
+		for(; end - p >= ptrdiff_t(size - 1u + WIDTH); p += WIDTH) {
+			uint64_t mask = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(p), first)
+				& _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(p + size - 1u), last);
+			while(mask) {
+				const unsigned offset = __builtin_ctzll(mask);
+				if(memcmp(p + offset + 1u, needle + 1u, size - 2u) == 0) {
+					return p + offset;
+				}
+				mask &= mask - 1u;
+			}
+		}
+		return Avx2Kernels::find_substring(p, end, needle, size);
+	}
+
+};
+
+#endif
+
+#if defined(__aarch64__)
+
+struct NeonKernels {
+
+	static constexpr size_t WIDTH = 16u;
+
+	/**
+	 * Four bits a byte of a comparison result, the first set byte is ctz / 4.
+	 */
+	static uint64_t to_mask(uint8x16_t match) noexcept {
+		const uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(match), 4);
+		return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+	}
+
+	static const uint8_t* find_escape(const uint8_t* p, const uint8_t* end) noexcept {
+		const uint8x16_t quote = vdupq_n_u8('"');
+		const uint8x16_t backslash = vdupq_n_u8('\\');
+		const uint8x16_t control = vdupq_n_u8(0x20);
+		for(; end - p >= ptrdiff_t(WIDTH); p += WIDTH) {
+			const uint8x16_t block = vld1q_u8(p);
+			const uint8x16_t special = vorrq_u8(vorrq_u8(vceqq_u8(block, quote), vceqq_u8(block, backslash)),
+				vcltq_u8(block, control));
+			const uint64_t mask = to_mask(special);
+			if(mask) {
+				return p + (__builtin_ctzll(mask) >> 2u);
+			}
+		}
+		return ScalarKernels::find_escape(p, end);
+	}
+
+	static const uint8_t* find_structural(const uint8_t* p, const uint8_t* end) noexcept {
+		const uint8x16_t quote = vdupq_n_u8('"');
+		const uint8x16_t case_bit = vdupq_n_u8(0x20);
+		const uint8x16_t open = vdupq_n_u8('{');
+		const uint8x16_t close = vdupq_n_u8('}');
+		for(; end - p >= ptrdiff_t(WIDTH); p += WIDTH) {
+			const uint8x16_t block = vld1q_u8(p);
+			const uint8x16_t folded = vorrq_u8(block, case_bit);
+			const uint8x16_t special = vorrq_u8(vorrq_u8(vceqq_u8(folded, open), vceqq_u8(folded, close)),
+				vceqq_u8(block, quote));
+			const uint64_t mask = to_mask(special);
+			if(mask) {
+				return p + (__builtin_ctzll(mask) >> 2u);
+			}
+		}
+		return ScalarKernels::find_structural(p, end);
+	}
+
+	static const uint8_t* skip_whitespace(const uint8_t* p, const uint8_t* end) noexcept {
+		const uint8x16_t space = vdupq_n_u8(' ');
+		const uint8x16_t tab = vdupq_n_u8('\t');
+		const uint8x16_t lf = vdupq_n_u8('\n');
+		const uint8x16_t cr = vdupq_n_u8('\r');
+		for(; end - p >= ptrdiff_t(WIDTH); p += WIDTH) {
+			const uint8x16_t block = vld1q_u8(p);
+			const uint8x16_t ws = vorrq_u8(vorrq_u8(vceqq_u8(block, space), vceqq_u8(block, tab)),
+				vorrq_u8(vceqq_u8(block, lf), vceqq_u8(block, cr)));
+			const uint64_t mask = to_mask(vmvnq_u8(ws));
+			if(mask) {
+				return p + (__builtin_ctzll(mask) >> 2u);
+			}
+		}
+		return ScalarKernels::skip_whitespace(p, end);
+	}
+
+	static uint8x16_t utf8_errors(uint8x16_t input, uint8x16_t prev) noexcept {
+		const uint8x16_t nibble = vdupq_n_u8(0x0F);
+		const uint8x16_t prev1 = vextq_u8(prev, input, 15);
+		const uint8x16_t byte_1_high = vqtbl1q_u8(vld1q_u8(Utf8Tables::BYTE_1_HIGH), vshrq_n_u8(prev1, 4));
+		const uint8x16_t byte_1_low = vqtbl1q_u8(vld1q_u8(Utf8Tables::BYTE_1_LOW), vandq_u8(prev1, nibble));
+		const uint8x16_t byte_2_high = vqtbl1q_u8(vld1q_u8(Utf8Tables::BYTE_2_HIGH), vshrq_n_u8(input, 4));
+		const uint8x16_t special = vandq_u8(vandq_u8(byte_1_high, byte_1_low), byte_2_high);
+
+		const uint8x16_t third = vqsubq_u8(vextq_u8(prev, input, 14), vdupq_n_u8(0xE0u - 0x80u));
+		const uint8x16_t fourth = vqsubq_u8(vextq_u8(prev, input, 13), vdupq_n_u8(0xF0u - 0x80u));
+		const uint8x16_t must_continue = vandq_u8(vorrq_u8(third, fourth), vdupq_n_u8(0x80u));
+		return veorq_u8(must_continue, special);
+	}
+
+	static const uint8_t* validate_utf8(const uint8_t* begin, const uint8_t* end) noexcept {
+		static constexpr uint8_t LIMIT[WIDTH] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+			Utf8Tables::INCOMPLETE_3[0], Utf8Tables::INCOMPLETE_3[1], Utf8Tables::INCOMPLETE_3[2]};
+		const uint8x16_t limit = vld1q_u8(LIMIT);
+		const uint8_t* p = begin;
+		uint8x16_t prev = vdupq_n_u8(0);
+		uint8x16_t incomplete = vdupq_n_u8(0);
+		uint8x16_t error = vdupq_n_u8(0);
+		uint8_t tail[WIDTH];
+		while(p < end) {
+			uint8x16_t input;
+			if(end - p >= ptrdiff_t(WIDTH)) {
+				input = vld1q_u8(p);
+			} else {
+				memset(tail, 0, WIDTH);
+				memcpy(tail, p, end - p);
+				input = vld1q_u8(tail);
+			}
+			if(vmaxvq_u8(input) < 0x80u) {
+				error = vorrq_u8(error, incomplete);
+				incomplete = vdupq_n_u8(0);
+			} else {
+				error = vorrq_u8(error, utf8_errors(input, prev));
+				incomplete = vqsubq_u8(input, limit);
+			}
+			if(vmaxvq_u8(error) != 0) {
+				return ScalarKernels::validate_utf8(begin, end);
+			}
+			prev = input;
+			p += WIDTH;
+		}
+		if(vmaxvq_u8(incomplete) != 0) {
+			return ScalarKernels::validate_utf8(begin, end);
+		}
+		return end;
+	}
+
+
+	static const uint8_t* find_substring(const uint8_t* p, const uint8_t* end, const uint8_t* needle, size_t size) noexcept {
+		if(size < 2u) {
+			return ScalarKernels::find_substring(p, end, needle, size);
+		}
+		const uint8x16_t first = vdupq_n_u8(needle[0]);
+		const uint8x16_t last = vdupq_n_u8(needle[size - 1u]);
+		for(; end - p >= ptrdiff_t(size - 1u + WIDTH); p += WIDTH) {
+			uint64_t mask = to_mask(vandq_u8(vceqq_u8(vld1q_u8(p), first), vceqq_u8(vld1q_u8(p + size - 1u), last)));
+			while(mask) {
+				const unsigned offset = __builtin_ctzll(mask) >> 2u;
+				if(memcmp(p + offset + 1u, needle + 1u, size - 2u) == 0) {
+					return p + offset;
+				}
+				// Four bits a byte.
+				mask &= ~(uint64_t(0xFu) << (offset * 4u));
+			}
+		}
+		return ScalarKernels::find_substring(p, end, needle, size);
+	}
+
+};
+
+#endif
+
+inline Kernels Kernels::for_tier(CpuTier tier) noexcept {
+	switch(tier) {
+#if defined(__x86_64__) || defined(__i386__)
+		case CpuTier::Sse42:
+			return Kernels{tier, Sse42Kernels::find_escape, Sse42Kernels::find_structural,
+				Sse42Kernels::skip_whitespace, Sse42Kernels::validate_utf8, Sse42Kernels::find_substring};
+
+		case CpuTier::Avx2:
+			return Kernels{tier, Avx2Kernels::find_escape, Avx2Kernels::find_structural,
+				Avx2Kernels::skip_whitespace, Avx2Kernels::validate_utf8, Avx2Kernels::find_substring};
+
+		case CpuTier::Avx512:
+			return Kernels{tier, Avx512Kernels::find_escape, Avx512Kernels::find_structural,
+				Avx512Kernels::skip_whitespace, Avx2Kernels::validate_utf8, Avx512Kernels::find_substring};
+#endif
+
+#if defined(__aarch64__)
+		case CpuTier::Neon:
+			return Kernels{tier, NeonKernels::find_escape, NeonKernels::find_structural,
+				NeonKernels::skip_whitespace, NeonKernels::validate_utf8, NeonKernels::find_substring};
+#endif
+
+		default:
+			return Kernels{CpuTier::Scalar, ScalarKernels::find_escape, ScalarKernels::find_structural,
+				ScalarKernels::skip_whitespace, ScalarKernels::validate_utf8, ScalarKernels::find_substring};
+	}
+}
+
+} // namespace jjson
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <lib/jjson/type.h>
+#include <lib/jjson/Hash.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace jjson {
+
+/**
+ * Maps the distinct object keys to the dense ids 0, 1, 2...
+ *
+ * The keys are copied into the table, so it outlives the documents and is reused across the
+ * documents with the same schema: the ids of the known keys do not change.
+ * Open addressing with the linear probing, the slot keeps the id and a part of the hash,
+ * so a miss rarely touches the key bytes.
+ * The number of the keys is limited to protect from the documents where the keys are the data,
+ * the keys over the limit are not interned.
+ */
+class KeyTable {
+
+	struct Entry {
+		uint32_t offset;
+		uint32_t len;
+	};
+
+	/** id + 1, 0 is an empty slot. */
+	struct Slot {
+		uint32_t id;
+		uint32_t hash;
+	};
+
+	const size_t _max_keys;
+	std::vector<Slot> _slots;
+	std::vector<Entry> _entries;
+	std::string _chars;
+
+public:
+
+	static constexpr size_t DEFAULT_MAX_KEYS = 64 * 1024;
+
+	explicit KeyTable(size_t max_keys = DEFAULT_MAX_KEYS) :
+		_max_keys(max_keys < UINT32_MAX ? max_keys : UINT32_MAX - 1u),
+		_slots(64u, Slot{0, 0}) {}
+
+	/**
+	 * @return The id of the key, adds the key if it is new. Node::NO_KEY_ID if the table is full.
+	 */
+	uint32_t intern(std::string_view key) {
+		const uint64_t hash = Hash::hash64(key.data(), key.size());
+		size_t index = size_t(hash) & (_slots.size() - 1u);
+		const uint32_t tag = uint32_t(hash >> 32u);
+		for(;;) {
+			const Slot slot = _slots[index];
+			if(slot.id == 0) {
+				break;
+			}
+			if(slot.hash == tag && equals(slot.id - 1u, key)) {
+				return slot.id - 1u;
+			}
+			index = (index + 1u) & (_slots.size() - 1u);
+		}
+
+		if(_entries.size() >= _max_keys) {
+			return Node::NO_KEY_ID;
+		}
+		const auto id = uint32_t(_entries.size());
+		_entries.push_back(Entry{uint32_t(_chars.size()), uint32_t(key.size())});
+		_chars.append(key);
+		_slots[index] = Slot{id + 1u, tag};
+		if(_entries.size() * 2u > _slots.size()) {
+			grow();
+		}
+		return id;
+	}
+
+	/**
+	 * Resolves a field name once, the nodes are compared by Node::key_id afterwards.
+	 * @return Node::NO_KEY_ID if the key has not been seen.
+	 */
+	uint32_t find(std::string_view key) const noexcept {
+		const uint64_t hash = Hash::hash64(key.data(), key.size());
+		size_t index = size_t(hash) & (_slots.size() - 1u);
+		const uint32_t tag = uint32_t(hash >> 32u);
+		for(;;) {
+			const Slot slot = _slots[index];
+			if(slot.id == 0) {
+				return Node::NO_KEY_ID;
+			}
+			if(slot.hash == tag && equals(slot.id - 1u, key)) {
+				return slot.id - 1u;
+			}
+			index = (index + 1u) & (_slots.size() - 1u);
+		}
+	}
+
+	std::string_view key(uint32_t id) const noexcept {
+		const Entry& entry = _entries[id];
+		return std::string_view(_chars.data() + entry.offset, entry.len);
+	}
+
+	size_t size() const noexcept {
+		return _entries.size();
+	}
+
+	bool is_full() const noexcept {
+		return _entries.size() >= _max_keys;
+	}
+
+	/**
+	 * Forgets all the keys, the ids of the built documents become invalid.
+	 */
+	void clear() noexcept {
+		_slots.assign(64u, Slot{0, 0});
+		_entries.clear();
+		_chars.clear();
+	}
+
+	/**
+	 * @return The value node of the object member with the key, nullptr if there is no such member.
+	 */
+	static const Node* member(const Node* object, uint32_t key_id) noexcept {
+		if(key_id == Node::NO_KEY_ID) {
+			return nullptr;
+		}
+		for(const Node* key = object->value; key; key = key->next) {
+			if(key->key_id == key_id) {
+				return key->value;
+			}
+		}
+		return nullptr;
+	}
+
+private:
+
+	bool equals(uint32_t id, std::string_view key) const noexcept {
+		const Entry& entry = _entries[id];
+		return entry.len == key.size() && memcmp(_chars.data() + entry.offset, key.data(), key.size()) == 0;
+	}
+
+	void grow() {
+		std::vector<Slot> slots(_slots.size() * 2u, Slot{0, 0});
+		for(const Slot slot : _slots) {
+			if(slot.id) {
+				const Entry& entry = _entries[slot.id - 1u];
+				const uint64_t hash = Hash::hash64(_chars.data() + entry.offset, entry.len);
+				size_t index = size_t(hash) & (slots.size() - 1u);
+				while(slots[index].id) {
+					index = (index + 1u) & (slots.size() - 1u);
+				}
+				slots[index] = slot;
+			}
+		}
+		_slots.swap(slots);
+	}
+
+};
+
+} // namespace jjson
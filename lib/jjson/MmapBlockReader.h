@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace jjson {
+
+/**
+ * Maps a file and hands it out in blocks, see PreadBlockReader for the interface.
+ * The kernel read-ahead overlaps the I/O with the processing of the previous blocks.
+ */
+class MmapBlockReader {
+
+	const size_t _block_size;
+	const char* _data;
+	size_t _size;
+	size_t _offset;
+	std::string _error;
+
+public:
+
+	MmapBlockReader(const MmapBlockReader&) = delete;
+	MmapBlockReader& operator=(const MmapBlockReader&) = delete;
+
+	MmapBlockReader(MmapBlockReader&& rv) = delete;
+	MmapBlockReader& operator=(MmapBlockReader&&) = delete;
+
+	explicit MmapBlockReader(size_t block_size = 1024u * 1024u) noexcept :
+		_block_size(block_size), _data(nullptr), _size(0), _offset(0) {}
+
+	~MmapBlockReader() noexcept {
+		close();
+	}
+
+	bool open(const char* file_name) {
+		close();
+		_error.clear();
+		const int fd = ::open(file_name, O_RDONLY | O_CLOEXEC);
+		struct stat st;
+		if(fd < 0 || fstat(fd, &st) != 0) {
+			_error = std::string("open() : ") + strerror(errno);
+			if(fd >= 0) {
+				::close(fd);
+			}
+			return false;
+		}
+		_size = size_t(st.st_size);
+		if(_size) {
+			void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(data == MAP_FAILED) {
+				_error = std::string("mmap() : ") + strerror(errno);
+				_size = 0;
+			} else {
+				madvise(data, _size, MADV_SEQUENTIAL);
+				_data = static_cast<const char*>(data);
+			}
+		}
+		::close(fd);
+		return _error.empty();
+	}
+
+	void close() noexcept {
+		if(_data) {
+			munmap(const_cast<char*>(_data), _size);
+			_data = nullptr;
+		}
+		_size = 0;
+		_offset = 0;
+	}
+
+	bool next(std::string_view& block) noexcept {
+		if(_offset >= _size) {
+			return false;
+		}
+		const size_t len = _size - _offset < _block_size ? _size - _offset : _block_size;
+		block = std::string_view(_data + _offset, len);
+		_offset += len;
+		return true;
+	}
+
+	bool failed() const noexcept {
+		return not _error.empty();
+	}
+
+	const std::string& error() const noexcept {
+		return _error;
+	}
+
+};
+
+} // namespace jjson
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <string_view>
+
+namespace jjson {
+
+/**
+ * An input with at least PADDING readable bytes after the data, for the consumers which load
+ * whole words past the end, e.g. Validator. The loads past the data are only read, the results
+ * are always bounded by size(): the padding may hold any bytes, see DocumentSplitter.
+ * It does not own the data, see PaddedBuffer.
+ */
+class PaddedInput {
+
+	template <typename A> friend class BasicPaddedBuffer;
+
+	const char* _data;
+	size_t _size;
+
+	PaddedInput(const char* data, size_t size) noexcept : _data(data), _size(size) {}
+
+public:
+
+	static constexpr size_t PADDING = 64u;
+
+	PaddedInput() noexcept : _data(zeroes()), _size(0) {}
+
+	/**
+	 * The caller guarantees PADDING readable bytes after 'size' bytes of 'data'.
+	 */
+	static PaddedInput assume_padded(const char* data, size_t size) noexcept {
+		return PaddedInput(data, size);
+	}
+
+	const char* data() const noexcept {
+		return _data;
+	}
+
+	size_t size() const noexcept {
+		return _size;
+	}
+
+	bool empty() const noexcept {
+		return _size == 0;
+	}
+
+	std::string_view view() const noexcept {
+		return std::string_view(_data, _size);
+	}
+
+	/**
+	 * The first 'size' bytes, the rest of the data joins the padding.
+	 */
+	PaddedInput prefix(size_t size) const noexcept {
+		return PaddedInput(_data, size < _size ? size : _size);
+	}
+
+private:
+
+	static const char* zeroes() noexcept {
+		static const char ZEROES[PADDING] = {};
+		return ZEROES;
+	}
+
+};
+
+/**
+ * A growable buffer which keeps PaddedInput::PADDING zero bytes after the data.
+ * @tparam A - allocator of the bytes.
+ */
+template <typename A = std::allocator<char> >
+class BasicPaddedBuffer {
+
+	using Traits = std::allocator_traits<A>;
+
+	A _allocator;
+	char* _data;
+	size_t _size;
+	size_t _capacity;
+
+public:
+
+	BasicPaddedBuffer(const BasicPaddedBuffer&) = delete;
+	BasicPaddedBuffer& operator=(const BasicPaddedBuffer&) = delete;
+
+	BasicPaddedBuffer(BasicPaddedBuffer&& rv) noexcept :
+		_allocator(std::move(rv._allocator)), _data(rv._data), _size(rv._size), _capacity(rv._capacity) {
+		rv._data = nullptr;
+		rv._size = 0;
+		rv._capacity = 0;
+	}
+
+	BasicPaddedBuffer& operator=(BasicPaddedBuffer&&) = delete;
+
+	explicit BasicPaddedBuffer(const A& allocator = A()) noexcept :
+		_allocator(allocator), _data(nullptr), _size(0), _capacity(0) {}
+
+	explicit BasicPaddedBuffer(std::string_view data, const A& allocator = A()) :
+		BasicPaddedBuffer(allocator) {
+		assign(data);
+	}
+
+	~BasicPaddedBuffer() noexcept {
+		if(_data) {
+			Traits::deallocate(_allocator, _data, _capacity + PaddedInput::PADDING);
+		}
+	}
+
+	PaddedInput input() const noexcept {
+		return _data ? PaddedInput(_data, _size) : PaddedInput();
+	}
+
+	char* data() noexcept {
+		return _data;
+	}
+
+	const char* data() const noexcept {
+		return _data;
+	}
+
+	size_t size() const noexcept {
+		return _size;
+	}
+
+	size_t capacity() const noexcept {
+		return _capacity;
+	}
+
+	std::string_view view() const noexcept {
+		return std::string_view(_data, _size);
+	}
+
+	void clear() noexcept {
+		resize(0);
+	}
+
+	void assign(std::string_view data) {
+		_size = 0;
+		append(data);
+	}
+
+	void append(std::string_view data) {
+		reserve(_size + data.size());
+		memcpy(_data + _size, data.data(), data.size());
+		resize(_size + data.size());
+	}
+
+	/**
+	 * Drops the first 'len' bytes.
+	 */
+	void erase_front(size_t len) {
+		if(len == 0) {
+			return;
+		}
+		memmove(_data, _data + len, _size - len);
+		resize(_size - len);
+	}
+
+	/**
+	 * The new bytes are not initialized, the padding is zeroed.
+	 */
+	void resize(size_t size) {
+		if(_data == nullptr && size == 0) {
+			return;
+		}
+		reserve(size);
+		_size = size;
+		if(_data) {
+			memset(_data + _size, 0, PaddedInput::PADDING);
+		}
+	}
+
+	void reserve(size_t capacity) {
+		if(capacity <= _capacity && _data) {
+			return;
+		}
+		const size_t new_capacity = capacity > _capacity * 2u ? capacity : _capacity * 2u;
+		char* data = Traits::allocate(_allocator, new_capacity + PaddedInput::PADDING);
+		if(_data) {
+			memcpy(data, _data, _size);
+			Traits::deallocate(_allocator, _data, _capacity + PaddedInput::PADDING);
+		}
+		_data = data;
+		_capacity = new_capacity;
+		memset(_data + _size, 0, PaddedInput::PADDING);
+	}
+
+};
+
+using PaddedBuffer = BasicPaddedBuffer<>;
+
+} // namespace jjson
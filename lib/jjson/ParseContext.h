@@ -0,0 +1,181 @@
+#pragma once
+
+#include <lib/jjson/type.h>
+#include <lib/jjson/SaxParser.h>
+#include <lib/jjson/DomBuilder.h>
+#include <lib/jjson/PaddedInput.h>
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace jjson {
+
+/**
+ * A DomBuilder and its SaxParser kept warm for many small documents: the node pool, the stacks,
+ * the string arena and the padded copy of the input are allocated once and reused by every parse,
+ * so a parse of a small message costs the parse only.
+ *
+ * The node pool grows in place when a document does not fit: the document is parsed again with
+ * a node per input byte, the bound of the nodes of any document. The builder and the parser stay
+ * the same objects, so dom() and their settings survive the growth.
+ *
+ * The contexts of a thread are pooled, see acquire(), so a handler takes a warm one
+ * without owning it, the nested handlers take different ones. A returned context drops
+ * its settings, a context grown past MAX_POOLED_NODE_CAPACITY nodes or MAX_POOLED_COPY_CAPACITY
+ * bytes of the input copy is freed rather than pooled.
+ *
+ * IMPORTANT:
+ * - The DOM lives until the next parse() of the context or until the lease returns it to the pool.
+ * - parse() throws std::bad_alloc if the growth fails.
+ */
+class ParseContext {
+
+	/** The contexts a thread keeps in its pool, the rest are freed when they are returned. */
+	static constexpr size_t POOL_SIZE = 8u;
+
+	DomBuilder<> _dom;
+	SaxParser<DomBuilder<>> _parser;
+
+public:
+
+	/** The nodes of a new context, enough for the documents of a few KB. */
+	static constexpr size_t DEFAULT_NODE_CAPACITY = 1024u;
+
+	/** The largest node pool kept in the pool of a thread, a large message does not pin its pool. */
+	static constexpr size_t MAX_POOLED_NODE_CAPACITY = 64u * DEFAULT_NODE_CAPACITY;
+	static constexpr size_t MAX_POOLED_COPY_CAPACITY = 1024u * 1024u;
+
+	/**
+	 * A context taken from the pool of the thread, it goes back when the lease is destroyed.
+	 */
+	class Lease {
+
+		friend class ParseContext;
+
+		std::unique_ptr<ParseContext> _context;
+
+		explicit Lease(std::unique_ptr<ParseContext> context) noexcept : _context(std::move(context)) {}
+
+	public:
+
+		Lease(const Lease&) = delete;
+		Lease& operator=(const Lease&) = delete;
+
+		Lease(Lease&& rv) noexcept = default;
+		Lease& operator=(Lease&&) = delete;
+
+		~Lease() noexcept {
+			if(_context) {
+				ParseContext::release(std::move(_context));
+			}
+		}
+
+		ParseContext& operator*() const noexcept {
+			return *_context;
+		}
+
+		ParseContext* operator->() const noexcept {
+			return _context.get();
+		}
+
+	};
+
+	ParseContext(const ParseContext&) = delete;
+	ParseContext& operator=(const ParseContext&) = delete;
+
+	ParseContext(ParseContext&& rv) = delete;
+	ParseContext& operator=(ParseContext&&) = delete;
+
+	explicit ParseContext(size_t node_capacity = DEFAULT_NODE_CAPACITY) :
+		_dom(node_capacity), _parser(_dom) {}
+
+	/**
+	 * Takes a warm context from the pool of the calling thread or creates one.
+	 */
+	static Lease acquire() {
+		auto& pool = thread_pool();
+		if(pool.empty()) {
+			return Lease(std::make_unique<ParseContext>());
+		}
+		Lease result(std::move(pool.back()));
+		pool.pop_back();
+		return result;
+	}
+
+	/**
+	 * Copies the input to the padded buffer of the parser, see SaxParser::parse_copy().
+	 * @return The root or nullptr if the input is not a valid JSON document.
+	 */
+	const Node* parse(std::string_view input) {
+		if(_parser.parse_copy(input)) {
+			return _dom.root();
+		}
+		return grow(input.size()) && _parser.parse_copy(input) ? _dom.root() : nullptr;
+	}
+
+	/**
+	 * Parses the input in place, the DOM points to the input.
+	 * @return The root or nullptr if the input is not a valid JSON document.
+	 */
+	const Node* parse(const PaddedInput& input) {
+		if(_parser.parse(input)) {
+			return _dom.root();
+		}
+		return grow(input.size()) && _parser.parse(input) ? _dom.root() : nullptr;
+	}
+
+	DomBuilder<>& dom() noexcept {
+		return _dom;
+	}
+
+	const DomBuilder<>& dom() const noexcept {
+		return _dom;
+	}
+
+	SaxParser<DomBuilder<>>& parser() noexcept {
+		return _parser;
+	}
+
+	[[nodiscard]] std::string error() const noexcept {
+		return _parser.error();
+	}
+
+private:
+
+	/**
+	 * Grows the node pool to fit any document of the size, after an allocation reject only.
+	 * @return false if the failure is not an allocation reject.
+	 */
+	bool grow(size_t input_size) {
+		if(not _dom.is_allocation_reject()) {
+			return false;
+		}
+		_dom.set_capacity(input_size + 1u);
+		return true;
+	}
+
+	static std::vector<std::unique_ptr<ParseContext>>& thread_pool() noexcept {
+		thread_local std::vector<std::unique_ptr<ParseContext>> pool = []() {
+			std::vector<std::unique_ptr<ParseContext>> result;
+			result.reserve(POOL_SIZE);
+			return result;
+		}();
+		return pool;
+	}
+
+	static void release(std::unique_ptr<ParseContext> context) noexcept {
+		auto& pool = thread_pool();
+		if(pool.size() < POOL_SIZE && context->_dom.capacity() <= MAX_POOLED_NODE_CAPACITY
+				&& context->_parser.copy_capacity() <= MAX_POOLED_COPY_CAPACITY) {
+			context->_dom.set_key_table(nullptr);
+			context->_dom.set_contiguous(false);
+			context->_parser.set_mask(nullptr);
+			pool.push_back(std::move(context));
+		}
+	}
+
+};
+
+} // namespace jjson
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace jjson {
+
+/**
+ * Reads a file in blocks on a background thread with pread(), the thread fills the next
+ * buffers of the ring while the caller processes the current one.
+ * The thread is started by the first open() and serves the next files until the reader is destroyed.
+ *
+ * All the block readers share the interface:
+ * - bool next(std::string_view& block) : false at the end of the file or on an error,
+ *   the block stays valid until the next call.
+ * - bool failed(), const std::string& error().
+ */
+class PreadBlockReader {
+
+	struct Buffer {
+		std::unique_ptr<char[]> data;
+		size_t len = 0;
+		bool full = false;
+	};
+
+	const size_t _block_size;
+	int _fd;
+	std::vector<Buffer> _buffers;
+	size_t _current;
+	bool _has_current;
+	bool _eof;
+	/** A file is open, the thread reads it. */
+	bool _active;
+	/** The thread is in pread(), the file and the buffers can not be released. */
+	bool _reading;
+	bool _quit;
+	/** Counts the open() calls, the thread restarts at _offset on a new one. */
+	uint64_t _generation;
+	off_t _offset;
+	std::string _error;
+	std::mutex _mutex;
+	std::condition_variable _cv;
+	std::thread _thread;
+
+public:
+
+	PreadBlockReader(const PreadBlockReader&) = delete;
+	PreadBlockReader& operator=(const PreadBlockReader&) = delete;
+
+	PreadBlockReader(PreadBlockReader&& rv) = delete;
+	PreadBlockReader& operator=(PreadBlockReader&&) = delete;
+
+	/**
+	 * @param buffer_count - 2 for the double buffering, more to absorb the latency spikes.
+	 */
+	explicit PreadBlockReader(size_t block_size = 1024u * 1024u, size_t buffer_count = 2u) :
+		_block_size(block_size),
+		_fd(-1),
+		_buffers(buffer_count < 2u ? 2u : buffer_count),
+		_current(0),
+		_has_current(false),
+		_eof(true),
+		_active(false),
+		_reading(false),
+		_quit(false),
+		_generation(0),
+		_offset(0) {
+		for(auto& buffer : _buffers) {
+			buffer.data.reset(new char[block_size]);
+		}
+	}
+
+	~PreadBlockReader() noexcept {
+		close();
+		if(_thread.joinable()) {
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_quit = true;
+			}
+			_cv.notify_all();
+			_thread.join();
+		}
+	}
+
+	/**
+	 * @param offset - the reading starts there, see FileBlockReader.
+	 */
+	bool open(const char* file_name, uint64_t offset = 0) {
+		close();
+		const int fd = ::open(file_name, O_RDONLY | O_CLOEXEC);
+		if(fd < 0) {
+			_error = std::string("open() : ") + strerror(errno);
+			return false;
+		}
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_fd = fd;
+			_error.clear();
+			_eof = false;
+			_current = 0;
+			_has_current = false;
+			for(auto& buffer : _buffers) {
+				buffer.full = false;
+				buffer.len = 0;
+			}
+			_offset = off_t(offset);
+			_generation++;
+			_active = true;
+		}
+		if(not _thread.joinable()) {
+			_thread = std::thread(&PreadBlockReader::run, this);
+		}
+		_cv.notify_all();
+		return true;
+	}
+
+	/**
+	 * Stops the reading of the file, the thread stays for the next one.
+	 */
+	void close() noexcept {
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_active = false;
+			_cv.notify_all();
+			_cv.wait(lock, [this]() { return not _reading; });
+		}
+		if(_fd >= 0) {
+			::close(_fd);
+			_fd = -1;
+		}
+	}
+
+	bool next(std::string_view& block) {
+		std::unique_lock<std::mutex> lock(_mutex);
+		if(_has_current) {
+			// The caller is done with the current buffer, give it back to the reading thread.
+			_buffers[_current].full = false;
+			_current = (_current + 1u) % _buffers.size();
+			_has_current = false;
+			_cv.notify_all();
+		}
+		_cv.wait(lock, [this]() { return _buffers[_current].full || _eof || not _active; });
+		if(not _buffers[_current].full) {
+			return false;
+		}
+		_has_current = true;
+		block = std::string_view(_buffers[_current].data.get(), _buffers[_current].len);
+		return true;
+	}
+
+	bool failed() const noexcept {
+		return not _error.empty();
+	}
+
+	const std::string& error() const noexcept {
+		return _error;
+	}
+
+private:
+
+	void run() noexcept {
+		size_t index = 0;
+		off_t offset = 0;
+		uint64_t generation = 0;
+		for(;;) {
+			int fd;
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_cv.wait(lock, [this, index, generation]() {
+					return _quit || (_active && (generation != _generation || (not _eof && not _buffers[index].full)));
+				});
+				if(_quit) {
+					return;
+				}
+				if(generation != _generation) {
+					// The next file.
+					generation = _generation;
+					index = 0;
+					offset = _offset;
+					continue;
+				}
+				fd = _fd;
+				_reading = true;
+			}
+
+			Buffer& buffer = _buffers[index];
+			size_t len = 0;
+			ssize_t result = 0;
+			int error = 0;
+			while(len < _block_size) {
+				result = pread(fd, buffer.data.get() + len, _block_size - len, offset + off_t(len));
+				if(result < 0 && errno == EINTR) {
+					continue;
+				} else if(result <= 0) {
+					error = errno;
+					break;
+				}
+				len += size_t(result);
+			}
+
+			std::lock_guard<std::mutex> lock(_mutex);
+			_reading = false;
+			_cv.notify_all();
+			if(not _active) {
+				continue;
+			}
+			if(result < 0) {
+				_error = std::string("pread() : ") + strerror(error);
+			}
+			if(len) {
+				buffer.len = len;
+				buffer.full = true;
+				offset += off_t(len);
+				index = (index + 1u) % _buffers.size();
+			}
+			if(len < _block_size) {
+				_eof = true;
+			}
+		}
+	}
+
+};
+
+} // namespace jjson
@@ -0,0 +1,303 @@
+#pragma once
+
+#include <lib/jjson/type.h>
+#include <lib/jjson/Statistics.h>
+#include <lib/jjson/Kernels.h>
+#include <lib/jjson/PaddedInput.h>
+#include <lib/jjson/SaxParser.h>
+#include <lib/jjson/FieldMask.h>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace jjson {
+
+/**
+ * Rejects the records which can not match a predicate before they are parsed:
+ * every needle must occur in the raw bytes of a record, see Kernels::find_substring().
+ * A record which passes may still not match, the parser confirms it, see RecordFilter.
+ *
+ * The needles are searched in the order they are added, put the rarest first.
+ *
+ * IMPORTANT:
+ * - The bytes are compared as they are: a record which spells a needle with the escape sequences,
+ *   e.g. "st\u0061tus", is rejected.
+ *
+ * @tparam S - statistics policy, the records tested and passed, see jjson::NoStatistics.
+ */
+template <typename S = DefaultStatistics>
+class Prefilter {
+
+	const Kernels& _kernels;
+	std::vector<std::string> _needles;
+	size_t _records;
+	size_t _passed;
+
+public:
+
+	Prefilter() noexcept : _kernels(Kernels::get()), _records(0), _passed(0) {}
+
+	void add(std::string_view needle) {
+		if(not needle.empty()) {
+			_needles.emplace_back(needle);
+		}
+	}
+
+	void clear() noexcept {
+		_needles.clear();
+		reset_statistics();
+	}
+
+	bool empty() const noexcept {
+		return _needles.empty();
+	}
+
+	/**
+	 * @return false if the record lacks a needle, it can not match.
+	 */
+	bool may_match(std::string_view record) noexcept {
+		const auto begin = reinterpret_cast<const uint8_t*>(record.data());
+		const auto end = begin + record.size();
+		bool result = true;
+		for(const auto& needle : _needles) {
+			const auto data = reinterpret_cast<const uint8_t*>(needle.data());
+			if(_kernels.find_substring(begin, end, data, needle.size()) == end) {
+				result = false;
+				break;
+			}
+		}
+		_records++;
+		_passed += result;
+		S::prefilter(result);
+		return result;
+	}
+
+	size_t records() const noexcept {
+		return _records;
+	}
+
+	size_t passed() const noexcept {
+		return _passed;
+	}
+
+	/**
+	 * @return The share of the records which have passed, 1 if none has been tested.
+	 */
+	double selectivity() const noexcept {
+		return _records ? double(_passed) / double(_records) : 1.0;
+	}
+
+	void reset_statistics() noexcept {
+		_records = 0;
+		_passed = 0;
+	}
+
+};
+
+/**
+ * The SAX receiver which confirms the terms of a predicate: the top level key has the value.
+ * The values are compared as JSON tokens as in the input, e.g. "\"error\"", "null", "42".
+ */
+class SaxPredicate {
+
+	struct Term {
+		std::string key;
+		std::string value;
+	};
+
+	std::vector<Term> _terms;
+	std::string_view _key;
+	uint64_t _matched;
+	size_t _depth;
+
+public:
+
+	/** The limit of the terms, a bit per term. */
+	static constexpr size_t MAX_TERMS = 64u;
+
+	SaxPredicate() noexcept : _matched(0), _depth(0) {}
+
+	/**
+	 * @param key - the key content as in the input, without the quotes.
+	 * @param value - the JSON token of a string, a number or a literal.
+	 * @return false if there are MAX_TERMS terms already.
+	 */
+	bool add(std::string_view key, std::string_view value) {
+		if(_terms.size() == MAX_TERMS) {
+			return false;
+		}
+		_terms.push_back(Term{std::string(key), std::string(value)});
+		return true;
+	}
+
+	const std::vector<Term>& terms() const noexcept {
+		return _terms;
+	}
+
+	void clear() noexcept {
+		_terms.clear();
+	}
+
+	/**
+	 * @return true if the last document has all the terms.
+	 */
+	bool matched() const noexcept {
+		return _matched == all();
+	}
+
+	void document_start() noexcept {
+		_key = std::string_view();
+		_matched = 0;
+		_depth = 0;
+	}
+
+	bool document_stop() noexcept {
+		return true;
+	}
+
+	void document_failure() noexcept {
+		_matched = 0;
+	}
+
+	void sax_event(const SaxParserEvent event, const std::string_view data) noexcept {
+		switch(event) {
+			case SaxParserEvent::ObjectStart:
+			case SaxParserEvent::ArrayStart:
+				_depth++;
+				_key = std::string_view();
+				break;
+
+			case SaxParserEvent::ObjectStop:
+			case SaxParserEvent::ArrayStop:
+				_depth--;
+				break;
+
+			case SaxParserEvent::ObjectItemStart:
+				_key = _depth == 1u ? data.substr(1u, data.size() - 2u) : std::string_view();
+				break;
+
+			case SaxParserEvent::String:
+			case SaxParserEvent::Number:
+			case SaxParserEvent::Null:
+			case SaxParserEvent::Bool:
+				if(_depth == 1u && _key.data()) {
+					for(size_t i = 0; i < _terms.size(); ++i) {
+						if(_terms[i].key == _key && _terms[i].value == data) {
+							_matched |= uint64_t(1u) << i;
+						}
+					}
+				}
+				_key = std::string_view();
+				break;
+
+			case SaxParserEvent::ObjectItemStop:
+			case SaxParserEvent::ValueSeparator:
+				break;
+		}
+	}
+
+private:
+
+	uint64_t all() const noexcept {
+		return _terms.size() == MAX_TERMS ? ~uint64_t(0) : (uint64_t(1u) << _terms.size()) - 1u;
+	}
+
+};
+
+/**
+ * Filters the records of a stream, e.g. the lines of NDJSON, by a conjunction of key == value terms.
+ *
+ * A record goes through Prefilter first: the value and then the key of every term must occur in its bytes.
+ * The records which pass are parsed with the projection of the term keys, see SaxParser::set_mask(),
+ * and SaxPredicate confirms the terms. Only the top level keys of the objects are matched,
+ * a key with a '.' turns the projection off as FieldMask reads it as a path.
+ *
+ * RecordFilter<> filter;
+ * filter.add("status", "\"error\"");
+ * if(filter.match(line)) { ... }
+ *
+ * @tparam S - statistics policy, see jjson::NoStatistics.
+ */
+template <typename S = DefaultStatistics>
+class RecordFilter {
+
+	Prefilter<S> _prefilter;
+	SaxPredicate _predicate;
+	SaxParser<SaxPredicate, S> _parser;
+	FieldMask _mask;
+	size_t _matched;
+	bool _use_prefilter;
+
+public:
+
+	RecordFilter(const RecordFilter&) = delete;
+	RecordFilter& operator=(const RecordFilter&) = delete;
+
+	RecordFilter(RecordFilter&& rv) = delete;
+	RecordFilter& operator=(RecordFilter&&) = delete;
+
+	RecordFilter() : _parser(_predicate), _matched(0), _use_prefilter(true) {
+		_parser.set_mask(&_mask);
+	}
+
+	/**
+	 * @param key - the top level key as in the input, without the quotes.
+	 * @param value - the JSON token of a string, a number or a literal as in the input.
+	 * @return false if there are SaxPredicate::MAX_TERMS terms already.
+	 */
+	bool add(std::string_view key, std::string_view value) {
+		if(not _predicate.add(key, value)) {
+			return false;
+		}
+		_prefilter.add(value);
+		std::string quoted;
+		quoted.reserve(key.size() + 2u);
+		quoted.push_back('"');
+		quoted.append(key);
+		quoted.push_back('"');
+		_prefilter.add(quoted);
+		if(key.find('.') == std::string_view::npos) {
+			_mask.add(key);
+		} else {
+			_parser.set_mask(nullptr);
+		}
+		return true;
+	}
+
+	/**
+	 * Disables the prefilter, every record is parsed. The results are the same, for the comparisons.
+	 */
+	void set_prefilter(bool enabled) noexcept {
+		_use_prefilter = enabled;
+	}
+
+	bool match(const PaddedInput& record) noexcept {
+		if(_use_prefilter && not _prefilter.may_match(record.view())) {
+			return false;
+		}
+		const bool result = _parser.parse(record) && _predicate.matched();
+		_matched += result;
+		return result;
+	}
+
+	const Prefilter<S>& prefilter() const noexcept {
+		return _prefilter;
+	}
+
+	/**
+	 * @return The records which have matched since the last reset_statistics().
+	 */
+	size_t matched() const noexcept {
+		return _matched;
+	}
+
+	void reset_statistics() noexcept {
+		_prefilter.reset_statistics();
+		_matched = 0;
+	}
+
+};
+
+} // namespace jjson
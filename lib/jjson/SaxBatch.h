@@ -0,0 +1,188 @@
+#pragma once
+
+#include <lib/jjson/type.h>
+#include <lib/jjson/SaxParser.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace jjson {
+
+/**
+ * A compact SAX event, 16 bytes: the data is at 'offset' from the base of its batch, see SaxBatch::data().
+ * The depth is the nesting of the event: the start and the stop of a container are at the depth of
+ * the container, its items are one level deeper.
+ */
+struct SaxEvent {
+	uint32_t offset;
+	uint32_t length;
+	uint32_t depth;
+	SaxParserEvent type;
+};
+
+/**
+ * The events delivered to a batch receiver at once, see SaxBatcher.
+ * The data of the events points to the input and is valid as the views of SaxParser are.
+ */
+class SaxBatch {
+
+	const char* _base;
+	const SaxEvent* _events;
+	size_t _size;
+
+public:
+
+	static constexpr std::string_view VALUE_SEPARATOR = ",";
+
+	SaxBatch(const char* base, const SaxEvent* events, size_t size) noexcept :
+		_base(base), _events(events), _size(size) {}
+
+	const SaxEvent* begin() const noexcept {
+		return _events;
+	}
+
+	const SaxEvent* end() const noexcept {
+		return _events + _size;
+	}
+
+	size_t size() const noexcept {
+		return _size;
+	}
+
+	/**
+	 * @return The data of the event as SaxParser passes it, ValueSeparator is always ','.
+	 */
+	std::string_view data(const SaxEvent& event) const noexcept {
+		if(event.type == SaxParserEvent::ValueSeparator) {
+			return VALUE_SEPARATOR;
+		}
+		return std::string_view(_base + event.offset, event.length);
+	}
+
+};
+
+/**
+ * The SAX receiver which collects the events of SaxParser into a fixed array and hands it
+ * to the batch receiver when it is full and when the document ends, so the receiver runs
+ * a tight loop over the compact events rather than a call per token.
+ *
+ * SaxBatcher<Receiver> batcher(receiver);
+ * SaxParser<SaxBatcher<Receiver>> parser(batcher);
+ *
+ * The batch receiver has document_start(), document_stop(), document_failure() as the SAX receiver
+ * and sax_batch(const SaxBatch&) instead of sax_event(), see SaxStringBuilder.
+ * The events before a failure are delivered before document_failure().
+ *
+ * IMPORTANT:
+ * - The ValueSeparator events are not located in the input: with a projection the parser passes
+ *   a ',' which is not there, see SaxParser::set_mask().
+ * - A token longer than 4 GiB fails the document.
+ * - The exceptions of the batch receiver, e.g. std::bad_alloc of a growing output, pass through.
+ *
+ * @tparam T - the batch receiver.
+ * @tparam N - the events in a batch.
+ */
+template <typename T, size_t N = 256u>
+class SaxBatcher {
+
+	static_assert(N > 0, "an empty batch");
+
+	T& _receiver;
+	const char* _base;
+	size_t _size;
+	uint32_t _depth;
+	bool _overflow;
+	SaxEvent _events[N];
+
+public:
+
+	SaxBatcher(const SaxBatcher&) = delete;
+	SaxBatcher& operator=(const SaxBatcher&) = delete;
+
+	SaxBatcher(SaxBatcher&& rv) = delete;
+	SaxBatcher& operator=(SaxBatcher&&) = delete;
+
+	explicit SaxBatcher(T& receiver) noexcept :
+		_receiver(receiver), _base(nullptr), _size(0), _depth(0), _overflow(false) {}
+
+	const T& receiver() const noexcept {
+		return _receiver;
+	}
+
+	void document_start() {
+		_base = nullptr;
+		_size = 0;
+		_depth = 0;
+		_overflow = false;
+		_receiver.document_start();
+	}
+
+	bool document_stop() {
+		if(_overflow) {
+			_size = 0;
+			_receiver.document_failure();
+			return false;
+		}
+		flush();
+		return _receiver.document_stop();
+	}
+
+	void document_failure() {
+		if(not _overflow) {
+			flush();
+		}
+		_size = 0;
+		_receiver.document_failure();
+	}
+
+	void sax_event(const SaxParserEvent event, const std::string_view data) {
+		if(_overflow) {
+			return;
+		}
+		if(_size == N) {
+			flush();
+		}
+		uint32_t depth = _depth;
+		switch(event) {
+			case SaxParserEvent::ObjectStart:
+			case SaxParserEvent::ArrayStart:
+				_depth++;
+				break;
+
+			case SaxParserEvent::ObjectStop:
+			case SaxParserEvent::ArrayStop:
+				depth = --_depth;
+				break;
+
+			case SaxParserEvent::ValueSeparator:
+				_events[_size++] = SaxEvent{0, 1u, depth, event};
+				return;
+
+			default:
+				break;
+		}
+		if(data.size() > UINT32_MAX) {
+			_overflow = true;
+			return;
+		}
+		if(_base == nullptr || size_t(data.data() - _base) > UINT32_MAX - data.size()) {
+			flush();
+			_base = data.data();
+		}
+		_events[_size++] = SaxEvent{uint32_t(data.data() - _base), uint32_t(data.size()), depth, event};
+	}
+
+private:
+
+	void flush() {
+		if(_size) {
+			_receiver.sax_batch(SaxBatch(_base, _events, _size));
+			_size = 0;
+		}
+		_base = nullptr;
+	}
+
+};
+
+} // namespace jjson
@@ -2,9 +2,11 @@
 
 #include <lib/jjson/type.h>
 #include <lib/jjson/Tokenizer.h>
+#include <lib/jjson/FieldMask.h>
 
 #include <vector>
 #include <string>
+#include <memory>
 
 namespace jjson {
 
@@ -49,7 +51,12 @@ enum class SaxParserEvent : char {
 	Bool
 };
 
-template <typename T>
+/**
+ * @tparam T - receiver of the events, see jjson::SaxStringBuilder.
+ * @tparam S - statistics policy, see jjson::NoStatistics.
+ * @tparam A - allocator of the state stack and the error message, see jjson::pmr::SaxParser.
+ */
+template <typename T, typename S = DefaultStatistics, typename A = std::allocator<char> >
 class SaxParser {
 
 	static constexpr int ERROR_TOKEN_LIMIT = 10;
@@ -65,26 +72,120 @@ class SaxParser {
 		Failure
 	};
 
-	Tokenizer _tkz;
-	std::vector<State> _stack;
-	std::string _error;
+	/**
+	 * The projection state of an open object or array.
+	 */
+	struct MaskFrame {
+		/** The mask of the object or the array, see FieldMask::find(). */
+		size_t node;
+		/** The mask of the value of the current object item. */
+		size_t item;
+		/** An item of the object has passed, the next one needs a separator. */
+		bool has_item;
+		bool is_array;
+	};
+
+	using StateAllocator = typename std::allocator_traits<A>::template rebind_alloc<State>;
+	using CharAllocator = typename std::allocator_traits<A>::template rebind_alloc<char>;
+	using MaskFrameAllocator = typename std::allocator_traits<A>::template rebind_alloc<MaskFrame>;
+
+	static constexpr std::string_view VALUE_SEPARATOR = ",";
+
+	Tokenizer<S> _tkz;
+	BasicPaddedBuffer<CharAllocator> _padded;
+	std::vector<State, StateAllocator> _stack;
+	std::basic_string<char, std::char_traits<char>, CharAllocator> _error;
 	T& _receiver;
+	size_t _depth;
+	const FieldMask* _mask;
+	std::vector<MaskFrame, MaskFrameAllocator> _mask_stack;
 
 public:
 
-	SaxParser(T& receiver) noexcept : _receiver(receiver) {}
+	SaxParser(T& receiver, const A& allocator = A()) noexcept :
+		_padded(CharAllocator(allocator)),
+		_stack(StateAllocator(allocator)),
+		_error(CharAllocator(allocator)),
+		_receiver(receiver),
+		_depth(0),
+		_mask(nullptr),
+		_mask_stack(MaskFrameAllocator(allocator)) {}
+
+	/**
+	 * Projection: only the object items of the mask reach the receiver, the values of the other
+	 * items are skipped by Tokenizer::skip_container() without the events and the validation.
+	 * The ValueSeparator events of the filtered objects carry a ',' which is not in the input.
+	 * The mask is not owned, nullptr disables the projection.
+	 */
+	void set_mask(const FieldMask* mask) noexcept {
+		_mask = mask;
+	}
+
+	const FieldMask* mask() const noexcept {
+		return _mask;
+	}
 
 	const T& receiver() const noexcept {
 		return _receiver;
 	}
 
+	/**
+	 * Parses the input in place, the views passed to the receiver point to the input.
+	 * The input needs no padding: the tokenizer checks the end of the input on every read.
+	 */
 	bool parse(std::string_view strv) noexcept {
+		return parse(strv.data(), strv.size());
+	}
+
+	/**
+	 * Parses the input in place, the views passed to the receiver point to the input.
+	 */
+	bool parse(const PaddedInput& input) noexcept {
+		return parse(input.data(), input.size());
+	}
+
+	/**
+	 * Copies the input to an internal padded buffer and parses the copy, so the input may go away
+	 * while the views are in use: they point to the copy and stay valid until the next parse_copy().
+	 */
+	bool parse_copy(std::string_view strv) {
+		_padded.assign(strv);
+		return parse(_padded.input());
+	}
+
+	/**
+	 * @return The bytes of the buffer of parse_copy().
+	 */
+	size_t copy_capacity() const noexcept {
+		return _padded.capacity();
+	}
+
+	[[nodiscard]] std::string error() const noexcept {
+		return std::string(_error.data(), _error.size());
+	}
+
+	void dump(FILE* out) const {
+		fprintf(out, "<SaxParser>\n");
+		fprintf(out, "\t Token : %c '%.*s' %zu \n", char(_tkz.token_type()), int(_tkz.token_data_len()), _tkz.token_data(), _tkz.token_data_len());
+		fprintf(out, "\t Chars : read=%zu left=%zu\n", _tkz.chars_tokenized(), _tkz.chars_left());
+		fprintf(out, "\t Stack : ");
+		for(const auto item : _stack) {
+			fprintf(out, "%s, ", state_name(item));
+		}
+		fprintf(out, "\n");
+	}
+
+private:
+
+	bool parse(const char* data, size_t size) noexcept {
 		bool result = false;
 
-		_tkz.reset(strv);
+		_tkz.reset(data, size);
 		_stack.resize(0);
 		_stack.push_back(State::Value);
 		_error.clear();
+		_depth = 0;
+		_mask_stack.resize(0);
 
 		if(_tkz.token_read()) {
 			_receiver.document_start();
@@ -108,28 +209,13 @@ public:
 			}
 		}
 
+		S::document(result);
 		return result;
 	}
 
-	[[nodiscard]] std::string error() const noexcept {
-		return _error;
-	}
-
-	void dump(FILE* out) const {
-		fprintf(out, "<SaxParser>\n");
-		fprintf(out, "\t Token : %c '%.*s' %zu \n", char(_tkz.token_type()), int(_tkz.token_data_len()), _tkz.token_data(), _tkz.token_data_len());
-		fprintf(out, "\t Chars : read=%zu left=%zu\n", _tkz.chars_tokenized(), _tkz.chars_left());
-		fprintf(out, "\t Stack : ");
-		for(const auto item : _stack) {
-			fprintf(out, "%s, ", state_name(item));
-		}
-		fprintf(out, "\n");
-	}
-
-private:
-
 	void set_error(const char* message) noexcept {
 		_stack.push_back(State::Failure);
+		S::error();
 
 		_error.clear();
 
@@ -138,7 +224,7 @@ private:
 		}
 
 		_error.append(" : +");
-		_error.append(std::to_string(_tkz.chars_tokenized()));
+		_error.append(std::to_string(_tkz.chars_tokenized()).c_str());
 		_error.append(" token-type='");
 		_error.push_back(char(_tkz.token_type()));
 		_error.append("'");
@@ -155,7 +241,7 @@ private:
 		}
 
 		_error.append("\nStack [");
-		_error.append(std::to_string(_stack.size()));
+		_error.append(std::to_string(_stack.size()).c_str());
 		_error.append("] : ");
 		for(size_t i = 0; i < _stack.size(); ++i) {
 			_error.append(state_name(_stack[i]));
@@ -163,6 +249,97 @@ private:
 		}
 	}
 
+	/**
+	 * The nesting depth is tracked for the statistics only.
+	 */
+	void depth_increase() noexcept {
+		if constexpr (S::ENABLED) {
+			_depth++;
+			S::depth(_depth);
+		}
+	}
+
+	void depth_decrease() noexcept {
+		if constexpr (S::ENABLED) {
+			_depth--;
+		}
+	}
+
+	void mask_push(bool is_array) noexcept {
+		if(_mask) {
+			size_t node = FieldMask::ROOT;
+			if(not _mask_stack.empty()) {
+				const MaskFrame& parent = _mask_stack.back();
+				node = parent.is_array ? parent.node : parent.item;
+			}
+			_mask_stack.push_back(MaskFrame{node, node, false, is_array});
+		}
+	}
+
+	void mask_pop() noexcept {
+		if(_mask) {
+			_mask_stack.pop_back();
+		}
+	}
+
+	/**
+	 * @return true - the items of the current object are filtered by the mask.
+	 */
+	bool is_filtered() const noexcept {
+		return _mask && _mask_stack.back().node != FieldMask::ALL;
+	}
+
+	/**
+	 * The current token is the key of an item of a filtered object.
+	 */
+	bool read_masked_item() noexcept {
+		MaskFrame& frame = _mask_stack.back();
+		const std::string_view key = _tkz.token_data_view();
+		frame.item = _mask->find(frame.node, key.substr(1u, key.size() - 2u));
+
+		if(frame.item != FieldMask::NONE) {
+			if(frame.has_item) {
+				_receiver.sax_event(SaxParserEvent::ValueSeparator, VALUE_SEPARATOR);
+			}
+			frame.has_item = true;
+			_receiver.sax_event(SaxParserEvent::ObjectItemStart, key);
+			_stack.back() = State::ObjectListItemValue;
+			return true;
+		}
+
+		// Skip the ':' and the value.
+		if(not _tkz.token_read() || _tkz.token_type() != TokenType::NameSeparator) {
+			set_error("':' is expected");
+			return false;
+		}
+		if(not _tkz.token_read()) {
+			set_error("value is expected");
+			return false;
+		}
+		switch(_tkz.token_type()) {
+			case TokenType::ObjectBegin :
+			case TokenType::ArrayBegin :
+				if(not _tkz.skip_container()) {
+					set_error("unbalanced value is skipped");
+					return false;
+				}
+				break;
+
+			case TokenType::Null :
+			case TokenType::True :
+			case TokenType::False :
+			case TokenType::String :
+			case TokenType::Number :
+				break;
+
+			default:
+				set_error("value is expected");
+				return false;
+		}
+		_stack.pop_back();
+		return true;
+	}
+
 	bool step(const State state) noexcept {
 
 		bool read_next_token;
@@ -256,11 +433,15 @@ private:
 			case TokenType::ArrayBegin :
 				_receiver.sax_event(SaxParserEvent::ArrayStart, _tkz.token_data_view());
 				_stack.push_back(State::ArrayList);
+				depth_increase();
+				mask_push(true);
 				break;
 
 			case TokenType::ArrayEnd:
 				_stack.pop_back();
 				_receiver.sax_event(SaxParserEvent::ArrayStop, _tkz.token_data_view());
+				depth_decrease();
+				mask_pop();
 				break;
 
 			default:
@@ -297,11 +478,15 @@ private:
 			case TokenType::ObjectBegin :
 				_receiver.sax_event(SaxParserEvent::ObjectStart, _tkz.token_data_view());
 				_stack.push_back(State::ObjectList);
+				depth_increase();
+				mask_push(false);
 				break;
 
 			case TokenType::ObjectEnd:
 				_stack.pop_back();
 				_receiver.sax_event(SaxParserEvent::ObjectStop, _tkz.token_data_view());
+				depth_decrease();
+				mask_pop();
 				break;
 
 			default:
@@ -316,7 +501,9 @@ private:
 		bool result = true;
 		switch(tkn) {
 			case TokenType::ValueSeparator:
-				_receiver.sax_event(SaxParserEvent::ValueSeparator, _tkz.token_data_view());
+				if(not is_filtered()) {
+					_receiver.sax_event(SaxParserEvent::ValueSeparator, _tkz.token_data_view());
+				}
 				_stack.push_back(State::ObjectListItem);
 				break;
 
@@ -338,6 +525,9 @@ private:
 		bool result = true;
 		switch(tkn) {
 			case TokenType::String:
+				if(is_filtered()) {
+					return read_masked_item();
+				}
 				_receiver.sax_event(SaxParserEvent::ObjectItemStart, _tkz.token_data_view());
 				_stack.back() = State::ObjectListItemValue;
 				break;
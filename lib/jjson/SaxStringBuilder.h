@@ -2,11 +2,17 @@
 
 #include <lib/jjson/type.h>
 #include <lib/jjson/SaxParser.h>
+#include <lib/jjson/SaxBatch.h>
 
+#include <cstring>
 #include <string>
 
 namespace jjson {
 
+/**
+ * Writes the events back to the minified JSON, a SAX receiver and a batch receiver, see SaxBatcher.
+ * A batch is copied in runs of the input, see sax_batch().
+ */
 class SaxStringBuilder {
 
 	std::string _output;
@@ -60,6 +66,98 @@ public:
 
 	}
 
+	/**
+	 * The output grows once per batch. The tokens which are adjacent in the input, with the ',' and ':'
+	 * between them, are copied at once: a minified input is copied in runs.
+	 */
+	void sax_batch(const SaxBatch& batch) {
+		size_t bound = 0;
+		for(const SaxEvent& event : batch) {
+			bound += event.length + 1u;
+		}
+		const size_t size = _output.size();
+		_output.resize(size + bound);
+		char* out = _output.data() + size;
+		const char* run = nullptr;
+		const char* run_end = nullptr;
+		char glue = 0;
+		for(const SaxEvent& event : batch) {
+			switch (event.type) {
+				case SaxParserEvent::ObjectItemStop:
+					break;
+
+				case SaxParserEvent::ValueSeparator:
+					out = pend(out, run, run_end, glue, ',');
+					break;
+
+				case SaxParserEvent::ObjectItemStart:
+					out = located(out, run, run_end, glue, batch.data(event));
+					out = pend(out, run, run_end, glue, ':');
+					break;
+
+				default:
+					out = located(out, run, run_end, glue, batch.data(event));
+					break;
+			}
+		}
+		out = copy(out, run, run_end);
+		if(glue) {
+			*out++ = glue;
+		}
+		_output.resize(out - _output.data());
+	}
+
+private:
+
+	static char* copy(char* out, const char* begin, const char* end) noexcept {
+		const size_t size = end - begin;
+		if(size) {
+			memcpy(out, begin, size);
+		}
+		return out + size;
+	}
+
+	/**
+	 * Appends the token to the run if the pending glue and the token follow the run in the input,
+	 * otherwise the run and the glue are copied and the token starts a new run.
+	 * The glue byte of the input is read only when the token follows it, so the read stays
+	 * in the input: a ':' event comes before its ':' is read and the input needs no padding.
+	 */
+	static char* located(char* out, const char*& run, const char*& run_end, char& glue, std::string_view data) noexcept {
+		if(glue) {
+			if(run_end && data.data() == run_end + 1 && *run_end == glue) {
+				run_end++;
+			} else {
+				out = copy(out, run, run_end);
+				*out++ = glue;
+				run = nullptr;
+				run_end = nullptr;
+			}
+			glue = 0;
+		}
+		if(data.data() != run_end) {
+			out = copy(out, run, run_end);
+			run = data.data();
+			run_end = run;
+		}
+		run_end += data.size();
+		return out;
+	}
+
+	/**
+	 * The glue is resolved by the next token, see located().
+	 */
+	static char* pend(char* out, const char*& run, const char*& run_end, char& glue, char c) noexcept {
+		if(glue) {
+			out = copy(out, run, run_end);
+			*out++ = glue;
+			run = nullptr;
+			run_end = nullptr;
+		}
+		glue = c;
+		return out;
+	}
+
 };
 
 } // namespace jjson
@@ -0,0 +1,749 @@
+#pragma once
+
+#include <lib/jjson/type.h>
+#include <lib/jjson/SaxParser.h>
+#include <lib/jjson/DomIterator.h>
+#include <lib/jjson/ParseContext.h>
+#include <lib/jjson/Escape.h>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace jjson {
+
+/**
+ * The key paths of the transform stages, matched against the SAX events on the fly.
+ *
+ * The paths are the dot separated keys as FieldMask reads them, e.g. "user.email", every path gets an id.
+ * The arrays are transparent: "items.secret" is the key 'secret' of every object of the array 'items'.
+ * A path matches the value of its last key only, the values below it are matched by their own paths.
+ * The keys are compared with the key content as in the input, the escapes are not decoded.
+ *
+ * The stages feed every event they pass with event(), match() is the path of the current member:
+ * after ObjectItemStart and before the first event of its value.
+ */
+class SaxKeyPaths {
+
+	struct PathNode {
+		std::vector<std::pair<std::string, size_t> > children;
+		size_t id;
+	};
+
+	struct Frame {
+		size_t node;
+		bool is_array;
+	};
+
+	static constexpr size_t NO_NODE = SIZE_MAX;
+	static constexpr size_t ROOT = 0;
+
+	std::vector<PathNode> _nodes;
+	std::vector<Frame> _stack;
+	size_t _value;
+	size_t _size;
+
+public:
+
+	/** No path ends at the value. */
+	static constexpr size_t NONE = SIZE_MAX;
+
+	SaxKeyPaths() : _nodes(1u, PathNode{{}, NONE}), _value(ROOT), _size(0) {}
+
+	/**
+	 * @return The id of the path, the ids are 0, 1, 2... in the order of the calls, the same path keeps its id.
+	 */
+	size_t add(std::string_view path) {
+		size_t node = ROOT;
+		while(true) {
+			const size_t dot = path.find('.');
+			const std::string_view key = path.substr(0, dot);
+			size_t child = find(node, key);
+			if(child == NO_NODE) {
+				child = _nodes.size();
+				_nodes[node].children.emplace_back(std::string(key), child);
+				_nodes.push_back(PathNode{{}, NONE});
+			}
+			node = child;
+			if(dot == std::string_view::npos) {
+				break;
+			}
+			path.remove_prefix(dot + 1u);
+		}
+		if(_nodes[node].id == NONE) {
+			_nodes[node].id = _size++;
+		}
+		return _nodes[node].id;
+	}
+
+	size_t size() const noexcept {
+		return _size;
+	}
+
+	bool empty() const noexcept {
+		return _size == 0;
+	}
+
+	void reset() noexcept {
+		_stack.clear();
+		_value = ROOT;
+	}
+
+	/**
+	 * @return The id of the path which ends at the current member or NONE.
+	 */
+	size_t match() const noexcept {
+		return _value == NO_NODE ? NONE : _nodes[_value].id;
+	}
+
+	void event(const SaxParserEvent event, const std::string_view data) {
+		switch(event) {
+			case SaxParserEvent::ObjectStart:
+				_stack.push_back(Frame{_value, false});
+				_value = NO_NODE;
+				break;
+
+			case SaxParserEvent::ArrayStart:
+				// The elements take the path of the array.
+				_stack.push_back(Frame{_value, true});
+				break;
+
+			case SaxParserEvent::ObjectStop:
+			case SaxParserEvent::ArrayStop:
+				_stack.pop_back();
+				_value = (not _stack.empty() && _stack.back().is_array) ? _stack.back().node : NO_NODE;
+				break;
+
+			case SaxParserEvent::ObjectItemStart:
+				_value = _stack.empty() ? NO_NODE : find(_stack.back().node, data.substr(1u, data.size() - 2u));
+				break;
+
+			case SaxParserEvent::ObjectItemStop:
+				_value = NO_NODE;
+				break;
+
+			default:
+				break;
+		}
+	}
+
+private:
+
+	size_t find(size_t node, std::string_view key) const noexcept {
+		if(node == NO_NODE) {
+			return NO_NODE;
+		}
+		for(const auto& child : _nodes[node].children) {
+			if(child.first == key) {
+				return child.second;
+			}
+		}
+		return NO_NODE;
+	}
+
+};
+
+/**
+ * The helpers of the transform stages.
+ */
+struct SaxTransform {
+
+	static constexpr std::string_view OBJECT_STOP = "}";
+	static constexpr std::string_view ARRAY_STOP = "]";
+	static constexpr std::string_view VALUE_SEPARATOR = ",";
+	static constexpr std::string_view ITEM_STOP = "";
+
+	static constexpr bool is_value_start(SaxParserEvent event) noexcept {
+		switch(event) {
+			case SaxParserEvent::ObjectStart:
+			case SaxParserEvent::ArrayStart:
+			case SaxParserEvent::String:
+			case SaxParserEvent::Number:
+			case SaxParserEvent::Null:
+			case SaxParserEvent::Bool:
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	static constexpr bool is_start(SaxParserEvent event) noexcept {
+		return event == SaxParserEvent::ObjectStart || event == SaxParserEvent::ArrayStart;
+	}
+
+	static constexpr bool is_stop(SaxParserEvent event) noexcept {
+		return event == SaxParserEvent::ObjectStop || event == SaxParserEvent::ArrayStop;
+	}
+
+	/**
+	 * @return The event of a scalar JSON token: a string, a number or a literal.
+	 */
+	static SaxParserEvent scalar_event(std::string_view token) noexcept {
+		switch(token.empty() ? '\0' : token[0]) {
+			case '"':
+				return SaxParserEvent::String;
+			case 'n':
+				return SaxParserEvent::Null;
+			case 't':
+			case 'f':
+				return SaxParserEvent::Bool;
+			default:
+				return SaxParserEvent::Number;
+		}
+	}
+
+	/**
+	 * @return The text escaped and quoted as the events carry the keys and the strings.
+	 */
+	static std::string quote(std::string_view text) {
+		std::string result(Escape::size(text) + 2u, '"');
+		Escape::write(result.data() + 1u, text);
+		return result;
+	}
+
+	/**
+	 * Sends the subtree of a DOM node as the SAX events, the strings must be between the quotes in memory.
+	 * @param strip - drops the object members with the null values, as a merge patch applied to a non-object,
+	 * the arrays are copied as they are.
+	 * @return false if the subtree is deeper than the walker stack, a part of it has been sent.
+	 */
+	template <typename T>
+	static bool send(T& receiver, const Node* root, bool strip) {
+		DomWalker<> walker(root);
+		if(walker.done()) {
+			return true;
+		}
+		size_t arrays = 0;
+		const Node* dropped = nullptr;
+		do {
+			const Step& step = walker.step();
+			const Node* node = step.node;
+			if(dropped) {
+				if(node == dropped && step.visit == Visit::Leave) {
+					dropped = nullptr;
+				}
+				continue;
+			}
+			const bool stripping = strip && arrays == 0;
+			if(step.visit == Visit::Enter) {
+				switch(node->type) {
+					case NodeType::Object:
+						receiver.sax_event(SaxParserEvent::ObjectStart, node->data);
+						break;
+					case NodeType::Array:
+						arrays++;
+						receiver.sax_event(SaxParserEvent::ArrayStart, node->data);
+						break;
+					case NodeType::Key:
+						if(stripping && is_null(node->value)) {
+							dropped = node;
+							break;
+						}
+						receiver.sax_event(SaxParserEvent::ObjectItemStart, quoted(node->data));
+						break;
+					case NodeType::String:
+						receiver.sax_event(SaxParserEvent::String, quoted(node->data));
+						break;
+					case NodeType::Number:
+						receiver.sax_event(SaxParserEvent::Number, node->data);
+						break;
+					case NodeType::Bool:
+						receiver.sax_event(SaxParserEvent::Bool, node->data);
+						break;
+					case NodeType::Null:
+						receiver.sax_event(SaxParserEvent::Null, node->data);
+						break;
+					default:
+						break;
+				}
+				continue;
+			}
+			switch(node->type) {
+				case NodeType::Object:
+					receiver.sax_event(SaxParserEvent::ObjectStop, OBJECT_STOP);
+					break;
+				case NodeType::Array:
+					arrays--;
+					receiver.sax_event(SaxParserEvent::ArrayStop, ARRAY_STOP);
+					break;
+				case NodeType::Key:
+					receiver.sax_event(SaxParserEvent::ObjectItemStop, ITEM_STOP);
+					break;
+				default:
+					break;
+			}
+			if(step.depth > 0 && next_sent(node, strip && (arrays == 0))) {
+				receiver.sax_event(SaxParserEvent::ValueSeparator, VALUE_SEPARATOR);
+			}
+		} while(walker.next());
+		return not walker.overflow();
+	}
+
+private:
+
+	static bool is_null(const Node* node) noexcept {
+		return node && node->type == NodeType::Null;
+	}
+
+	static std::string_view quoted(std::string_view content) noexcept {
+		return std::string_view(content.data() - 1u, content.size() + 2u);
+	}
+
+	/**
+	 * @return true if a sibling after the node is sent.
+	 */
+	static bool next_sent(const Node* node, bool strip) noexcept {
+		const Node* next = node->next;
+		if(strip && node->type == NodeType::Key) {
+			while(next && is_null(next->value)) {
+				next = next->next;
+			}
+		}
+		return next != nullptr;
+	}
+
+};
+
+/**
+ * Replaces the values of the paths with a JSON token, "***" by default: a scalar or a whole subtree.
+ *
+ * SaxStringBuilder output;
+ * SaxRedact<SaxStringBuilder> redact(output);
+ * redact.add("user.email");
+ * SaxParser<SaxRedact<SaxStringBuilder>> parser(redact);
+ *
+ * The stages take the next receiver by reference and chain as the template arguments, the whole chain
+ * is inlined into the parser. A stage keeps O(depth) memory, the document passes in one pass.
+ *
+ * @tparam T - the next receiver: a stage or an output, e.g. SaxStringBuilder, DomBuilder.
+ */
+template <typename T>
+class SaxRedact {
+
+	T& _next;
+	SaxKeyPaths _paths;
+	std::string _replacement;
+	SaxParserEvent _replacement_event;
+	size_t _skip;
+
+public:
+
+	SaxRedact(const SaxRedact&) = delete;
+	SaxRedact& operator=(const SaxRedact&) = delete;
+
+	SaxRedact(SaxRedact&& rv) = delete;
+	SaxRedact& operator=(SaxRedact&&) = delete;
+
+	explicit SaxRedact(T& next) :
+		_next(next), _replacement("\"***\""), _replacement_event(SaxParserEvent::String), _skip(0) {}
+
+	void add(std::string_view path) {
+		_paths.add(path);
+	}
+
+	/**
+	 * @param token - a scalar JSON token, e.g. "\"REDACTED\"", "null", "0".
+	 */
+	void set_replacement(std::string_view token) {
+		_replacement = std::string(token);
+		_replacement_event = SaxTransform::scalar_event(token);
+	}
+
+	const T& receiver() const noexcept {
+		return _next;
+	}
+
+	void document_start() {
+		_paths.reset();
+		_skip = 0;
+		_next.document_start();
+	}
+
+	bool document_stop() {
+		return _next.document_stop();
+	}
+
+	void document_failure() {
+		_next.document_failure();
+	}
+
+	void sax_event(const SaxParserEvent event, const std::string_view data) {
+		if(_skip) {
+			_skip += SaxTransform::is_start(event);
+			_skip -= SaxTransform::is_stop(event);
+			return;
+		}
+		if(SaxTransform::is_value_start(event) && _paths.match() != SaxKeyPaths::NONE) {
+			_next.sax_event(_replacement_event, _replacement);
+			_skip = SaxTransform::is_start(event);
+			return;
+		}
+		_paths.event(event, data);
+		_next.sax_event(event, data);
+	}
+
+};
+
+/**
+ * Renames the keys of the paths, the paths name the old keys.
+ * @tparam T - the next receiver, see SaxRedact.
+ */
+template <typename T>
+class SaxRename {
+
+	T& _next;
+	SaxKeyPaths _paths;
+	std::vector<std::string> _keys;
+
+public:
+
+	SaxRename(const SaxRename&) = delete;
+	SaxRename& operator=(const SaxRename&) = delete;
+
+	SaxRename(SaxRename&& rv) = delete;
+	SaxRename& operator=(SaxRename&&) = delete;
+
+	explicit SaxRename(T& next) : _next(next) {}
+
+	/**
+	 * @param key - the new key as a text, it is escaped.
+	 */
+	void add(std::string_view path, std::string_view key) {
+		const size_t id = _paths.add(path);
+		if(id == _keys.size()) {
+			_keys.emplace_back();
+		}
+		_keys[id] = SaxTransform::quote(key);
+	}
+
+	const T& receiver() const noexcept {
+		return _next;
+	}
+
+	void document_start() {
+		_paths.reset();
+		_next.document_start();
+	}
+
+	bool document_stop() {
+		return _next.document_stop();
+	}
+
+	void document_failure() {
+		_next.document_failure();
+	}
+
+	void sax_event(const SaxParserEvent event, const std::string_view data) {
+		_paths.event(event, data);
+		if(event == SaxParserEvent::ObjectItemStart) {
+			const size_t id = _paths.match();
+			if(id != SaxKeyPaths::NONE) {
+				_next.sax_event(event, _keys[id]);
+				return;
+			}
+		}
+		_next.sax_event(event, data);
+	}
+
+};
+
+/**
+ * Drops the members of the paths with their subtrees, the separators are put again.
+ * @tparam T - the next receiver, see SaxRedact.
+ */
+template <typename T>
+class SaxDrop {
+
+	struct Frame {
+		bool is_object;
+		bool has_item;
+	};
+
+	T& _next;
+	SaxKeyPaths _paths;
+	std::vector<Frame> _frames;
+	size_t _skip;
+	bool _dropping;
+
+public:
+
+	SaxDrop(const SaxDrop&) = delete;
+	SaxDrop& operator=(const SaxDrop&) = delete;
+
+	SaxDrop(SaxDrop&& rv) = delete;
+	SaxDrop& operator=(SaxDrop&&) = delete;
+
+	explicit SaxDrop(T& next) : _next(next), _skip(0), _dropping(false) {}
+
+	void add(std::string_view path) {
+		_paths.add(path);
+	}
+
+	const T& receiver() const noexcept {
+		return _next;
+	}
+
+	void document_start() {
+		_paths.reset();
+		_frames.clear();
+		_skip = 0;
+		_dropping = false;
+		_next.document_start();
+	}
+
+	bool document_stop() {
+		return _next.document_stop();
+	}
+
+	void document_failure() {
+		_next.document_failure();
+	}
+
+	void sax_event(const SaxParserEvent event, const std::string_view data) {
+		if(_dropping) {
+			// The member ends with its ObjectItemStop at the level of the key.
+			if(event == SaxParserEvent::ObjectItemStop && _skip == 0) {
+				_dropping = false;
+			}
+			_skip += SaxTransform::is_start(event);
+			_skip -= SaxTransform::is_stop(event);
+			return;
+		}
+		switch(event) {
+			case SaxParserEvent::ObjectStart:
+			case SaxParserEvent::ArrayStart:
+				_frames.push_back(Frame{event == SaxParserEvent::ObjectStart, false});
+				break;
+
+			case SaxParserEvent::ObjectStop:
+			case SaxParserEvent::ArrayStop:
+				_frames.pop_back();
+				break;
+
+			case SaxParserEvent::ValueSeparator:
+				// The separators of the objects are put before the kept members.
+				if(_frames.back().is_object) {
+					return;
+				}
+				break;
+
+			case SaxParserEvent::ObjectItemStart:
+				_paths.event(event, data);
+				if(_paths.match() != SaxKeyPaths::NONE) {
+					_dropping = true;
+					return;
+				}
+				if(_frames.back().has_item) {
+					_next.sax_event(SaxParserEvent::ValueSeparator, SaxTransform::VALUE_SEPARATOR);
+				}
+				_frames.back().has_item = true;
+				_next.sax_event(event, data);
+				return;
+
+			default:
+				break;
+		}
+		_paths.event(event, data);
+		_next.sax_event(event, data);
+	}
+
+};
+
+/**
+ * Applies a JSON Merge Patch, RFC 7396, to the stream: the members of the patch with the null values
+ * are removed, the objects of both are merged, the other values of the patch replace the values
+ * of the document, the members which are not in the document are appended to the objects.
+ * The subtrees which the patch does not touch pass as they are.
+ *
+ * The keys are compared with the key content as in the input and in the patch, the escapes are not decoded.
+ * The patch is parsed once and kept, a document holds O(depth * patch width) of the state.
+ *
+ * @tparam T - the next receiver, see SaxRedact.
+ */
+template <typename T>
+class SaxMergePatch {
+
+	struct Frame {
+		/** The patch object of the document object. */
+		const Node* patch;
+		/** The flags of the patch members seen in the object, in _seen. */
+		size_t seen;
+		bool has_item;
+	};
+
+	T& _next;
+	ParseContext _context;
+	const Node* _patch;
+	std::vector<Frame> _frames;
+	std::vector<uint8_t> _seen;
+	/** The patch of the value which starts next, nullptr if the patch does not touch it. */
+	const Node* _value;
+	/** The depth in the subtree passed as it is. */
+	size_t _plain;
+	/** The depth in the subtree replaced or removed. */
+	size_t _skip;
+	bool _dropping;
+
+public:
+
+	SaxMergePatch(const SaxMergePatch&) = delete;
+	SaxMergePatch& operator=(const SaxMergePatch&) = delete;
+
+	SaxMergePatch(SaxMergePatch&& rv) = delete;
+	SaxMergePatch& operator=(SaxMergePatch&&) = delete;
+
+	explicit SaxMergePatch(T& next) :
+		_next(next), _patch(nullptr), _value(nullptr), _plain(0), _skip(0), _dropping(false) {}
+
+	/**
+	 * @return false if the patch is not a valid JSON document, the stage passes the documents as they are.
+	 */
+	bool set_patch(std::string_view patch) {
+		_patch = _context.parse(patch);
+		return _patch != nullptr;
+	}
+
+	const T& receiver() const noexcept {
+		return _next;
+	}
+
+	void document_start() {
+		_frames.clear();
+		_seen.clear();
+		_value = _patch;
+		_plain = 0;
+		_skip = 0;
+		_dropping = false;
+		_next.document_start();
+	}
+
+	bool document_stop() {
+		return _next.document_stop();
+	}
+
+	void document_failure() {
+		_next.document_failure();
+	}
+
+	void sax_event(const SaxParserEvent event, const std::string_view data) {
+		if(_plain) {
+			_plain += SaxTransform::is_start(event);
+			_plain -= SaxTransform::is_stop(event);
+			_next.sax_event(event, data);
+			return;
+		}
+		if(_skip || _dropping) {
+			if(_dropping && _skip == 0 && event == SaxParserEvent::ObjectItemStop) {
+				_dropping = false;
+				return;
+			}
+			_skip += SaxTransform::is_start(event);
+			_skip -= SaxTransform::is_stop(event);
+			return;
+		}
+		switch(event) {
+			case SaxParserEvent::ObjectStart:
+			case SaxParserEvent::ArrayStart:
+			case SaxParserEvent::String:
+			case SaxParserEvent::Number:
+			case SaxParserEvent::Null:
+			case SaxParserEvent::Bool:
+				value(event, data);
+				break;
+
+			case SaxParserEvent::ObjectItemStart:
+				item(data);
+				break;
+
+			case SaxParserEvent::ObjectItemStop:
+				_value = nullptr;
+				_next.sax_event(event, data);
+				break;
+
+			case SaxParserEvent::ValueSeparator:
+				// The separators of the patched objects are put before the members.
+				break;
+
+			case SaxParserEvent::ObjectStop:
+				append_unseen();
+				_seen.resize(_frames.back().seen);
+				_frames.pop_back();
+				_value = nullptr;
+				_next.sax_event(event, data);
+				break;
+
+			case SaxParserEvent::ArrayStop:
+				// The arrays are passed or replaced whole.
+				_next.sax_event(event, data);
+				break;
+		}
+	}
+
+private:
+
+	void value(const SaxParserEvent event, const std::string_view data) {
+		const Node* patch = _value;
+		_value = nullptr;
+		if(patch == nullptr) {
+			_plain = SaxTransform::is_start(event);
+			_next.sax_event(event, data);
+			return;
+		}
+		if(patch->type == NodeType::Object && event == SaxParserEvent::ObjectStart) {
+			_frames.push_back(Frame{patch, _seen.size(), false});
+			_seen.resize(_seen.size() + patch->size());
+			_next.sax_event(event, data);
+			return;
+		}
+		SaxTransform::send(_next, patch, true);
+		_skip = SaxTransform::is_start(event);
+	}
+
+	void item(const std::string_view key) {
+		Frame& frame = _frames.back();
+		const std::string_view content = key.substr(1u, key.size() - 2u);
+		size_t index = 0;
+		const Node* member = frame.patch->value;
+		for(; member; member = member->next, ++index) {
+			if(member->data == content) {
+				break;
+			}
+		}
+		if(member) {
+			_seen[frame.seen + index] = 1u;
+			if(member->value->type == NodeType::Null) {
+				_dropping = true;
+				return;
+			}
+		}
+		_value = member ? member->value : nullptr;
+		if(frame.has_item) {
+			_next.sax_event(SaxParserEvent::ValueSeparator, SaxTransform::VALUE_SEPARATOR);
+		}
+		frame.has_item = true;
+		_next.sax_event(SaxParserEvent::ObjectItemStart, key);
+	}
+
+	/**
+	 * The members of the patch which are not in the object, except the nulls.
+	 */
+	void append_unseen() {
+		Frame& frame = _frames.back();
+		size_t index = 0;
+		for(const Node* member = frame.patch->value; member; member = member->next, ++index) {
+			if(_seen[frame.seen + index] || member->value->type == NodeType::Null) {
+				continue;
+			}
+			if(frame.has_item) {
+				_next.sax_event(SaxParserEvent::ValueSeparator, SaxTransform::VALUE_SEPARATOR);
+			}
+			frame.has_item = true;
+			SaxTransform::send(_next, member, true);
+		}
+	}
+
+};
+
+} // namespace jjson
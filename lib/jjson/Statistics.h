@@ -0,0 +1,202 @@
+#pragma once
+
+#include <lib/jjson/type.h>
+
+#include <cstdio>
+
+namespace jjson {
+
+/**
+ * Counters of the tokens and the parser states, see ThreadLocalStatistics.
+ */
+struct ParserStatistics {
+
+	static constexpr size_t TOKEN_TYPES = 11u;
+	static constexpr size_t STRING_LENGTH_BUCKETS = 24u;
+
+	size_t documents;
+	size_t failures;
+	size_t errors;
+	size_t max_depth;
+	size_t whitespace_bytes;
+	// The records tested by Prefilter and the ones which have passed it to the parser.
+	size_t prefilter_records;
+	size_t prefilter_passed;
+	size_t tokens[TOKEN_TYPES];
+	// Bucket 'i' counts the strings of [2^(i-1), 2^i) chars including the quotes, the last one is open.
+	size_t string_lengths[STRING_LENGTH_BUCKETS];
+
+	void reset() noexcept {
+		*this = ParserStatistics();
+	}
+
+	void merge(const ParserStatistics& rv) noexcept {
+		documents += rv.documents;
+		failures += rv.failures;
+		errors += rv.errors;
+		max_depth = max_depth > rv.max_depth ? max_depth : rv.max_depth;
+		whitespace_bytes += rv.whitespace_bytes;
+		prefilter_records += rv.prefilter_records;
+		prefilter_passed += rv.prefilter_passed;
+		for(size_t i = 0; i < TOKEN_TYPES; ++i) {
+			tokens[i] += rv.tokens[i];
+		}
+		for(size_t i = 0; i < STRING_LENGTH_BUCKETS; ++i) {
+			string_lengths[i] += rv.string_lengths[i];
+		}
+	}
+
+	size_t token_count(TokenType type) const noexcept {
+		return tokens[token_index(type)];
+	}
+
+	static size_t token_index(TokenType type) noexcept {
+		switch(type) {
+			case TokenType::ObjectBegin:
+				return 0;
+			case TokenType::ObjectEnd:
+				return 1u;
+			case TokenType::ArrayBegin:
+				return 2u;
+			case TokenType::ArrayEnd:
+				return 3u;
+			case TokenType::NameSeparator:
+				return 4u;
+			case TokenType::ValueSeparator:
+				return 5u;
+			case TokenType::Null:
+				return 6u;
+			case TokenType::True:
+				return 7u;
+			case TokenType::False:
+				return 8u;
+			case TokenType::String:
+				return 9u;
+			case TokenType::Number:
+			default:
+				return 10u;
+		}
+	}
+
+	static size_t string_length_bucket(size_t len) noexcept {
+		const size_t bucket = len ? size_t(64 - __builtin_clzll(len)) : 0;
+		return bucket < STRING_LENGTH_BUCKETS ? bucket : STRING_LENGTH_BUCKETS - 1u;
+	}
+
+	void dump(FILE* out) const {
+		static constexpr TokenType TYPES[TOKEN_TYPES] = {
+			TokenType::ObjectBegin, TokenType::ObjectEnd, TokenType::ArrayBegin, TokenType::ArrayEnd,
+			TokenType::NameSeparator, TokenType::ValueSeparator, TokenType::Null, TokenType::True,
+			TokenType::False, TokenType::String, TokenType::Number
+		};
+		fprintf(out, "<ParserStatistics>\n");
+		fprintf(out, "\t Documents : %zu failures=%zu errors=%zu\n", documents, failures, errors);
+		fprintf(out, "\t Depth : max=%zu\n", max_depth);
+		fprintf(out, "\t Whitespace : %zu bytes\n", whitespace_bytes);
+		if(prefilter_records) {
+			fprintf(out, "\t Prefilter : records=%zu passed=%zu selectivity=%.2f%%\n", prefilter_records, prefilter_passed,
+				100.0 * double(prefilter_passed) / double(prefilter_records));
+		}
+		fprintf(out, "\t Tokens : ");
+		for(const auto type : TYPES) {
+			fprintf(out, "%c=%zu ", char(type), token_count(type));
+		}
+		fprintf(out, "\n\t String lengths : ");
+		for(size_t i = 0; i < STRING_LENGTH_BUCKETS; ++i) {
+			if(string_lengths[i]) {
+				fprintf(out, "<%zu=%zu ", size_t(1) << i, string_lengths[i]);
+			}
+		}
+		fprintf(out, "\n");
+	}
+
+};
+
+/**
+ * The default statistics policy of Tokenizer and SaxParser, all the calls compile to nothing.
+ */
+struct NoStatistics {
+
+	static constexpr bool ENABLED = false;
+
+	static void token(TokenType, size_t) noexcept {}
+	static void whitespace(size_t) noexcept {}
+	static void depth(size_t) noexcept {}
+	static void error() noexcept {}
+	static void document(bool) noexcept {}
+	static void prefilter(bool) noexcept {}
+
+};
+
+/**
+ * The statistics policy which collects ParserStatistics of the calling thread.
+ * Each thread reads and resets its own counters, merge the snapshots to get the totals.
+ */
+struct ThreadLocalStatistics {
+
+	static constexpr bool ENABLED = true;
+
+	static ParserStatistics& local() noexcept {
+		thread_local ParserStatistics statistics = ParserStatistics();
+		return statistics;
+	}
+
+	static ParserStatistics snapshot() noexcept {
+		return local();
+	}
+
+	static void reset() noexcept {
+		local().reset();
+	}
+
+	static void token(TokenType type, size_t len) noexcept {
+		auto& statistics = local();
+		statistics.tokens[ParserStatistics::token_index(type)]++;
+		if(type == TokenType::String) {
+			statistics.string_lengths[ParserStatistics::string_length_bucket(len)]++;
+		}
+	}
+
+	static void whitespace(size_t len) noexcept {
+		local().whitespace_bytes += len;
+	}
+
+	static void depth(size_t depth) noexcept {
+		auto& statistics = local();
+		if(depth > statistics.max_depth) {
+			statistics.max_depth = depth;
+		}
+	}
+
+	static void error() noexcept {
+		local().errors++;
+	}
+
+	static void document(bool success) noexcept {
+		auto& statistics = local();
+		statistics.documents++;
+		if(not success) {
+			statistics.failures++;
+		}
+	}
+
+	static void prefilter(bool passed) noexcept {
+		auto& statistics = local();
+		statistics.prefilter_records++;
+		if(passed) {
+			statistics.prefilter_passed++;
+		}
+	}
+
+};
+
+/**
+ * Build with JJSON_STATISTICS defined to instrument all the parsers without changing the code.
+ */
+#if defined(JJSON_STATISTICS)
+using DefaultStatistics = ThreadLocalStatistics;
+#else
+using DefaultStatistics = NoStatistics;
+#endif
+
+} // namespace jjson
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace jjson {
+
+/**
+ * Bytes for the strings of an edited DOM, see DomEditor.
+ * The bytes never move, the blocks are freed by the destructor only, clear() reuses them.
+ * @tparam A - allocator of the blocks.
+ */
+template <typename A = std::allocator<char> >
+class BasicStringArena {
+
+	using Traits = std::allocator_traits<A>;
+
+	struct Block {
+		char* data;
+		size_t size;
+	};
+
+	using BlockAllocator = typename Traits::template rebind_alloc<Block>;
+
+	static constexpr size_t BLOCK_SIZE = 64u * 1024u;
+
+	A _allocator;
+	std::vector<Block, BlockAllocator> _blocks;
+	size_t _block;
+	size_t _used;
+
+public:
+
+	BasicStringArena(const BasicStringArena&) = delete;
+	BasicStringArena& operator=(const BasicStringArena&) = delete;
+
+	BasicStringArena(BasicStringArena&& rv) = delete;
+	BasicStringArena& operator=(BasicStringArena&&) = delete;
+
+	explicit BasicStringArena(const A& allocator = A()) noexcept :
+		_allocator(allocator), _blocks(BlockAllocator(allocator)), _block(0), _used(0) {}
+
+	~BasicStringArena() noexcept {
+		for(const auto& block : _blocks) {
+			Traits::deallocate(_allocator, block.data, block.size);
+		}
+	}
+
+	char* allocate(size_t size) {
+		while(_block < _blocks.size()) {
+			Block& block = _blocks[_block];
+			if(block.size - _used >= size) {
+				char* result = block.data + _used;
+				_used += size;
+				return result;
+			}
+			_block++;
+			_used = 0;
+		}
+		const size_t block_size = size > BLOCK_SIZE ? size : BLOCK_SIZE;
+		_blocks.push_back(Block{Traits::allocate(_allocator, block_size), block_size});
+		_block = _blocks.size() - 1u;
+		_used = size;
+		return _blocks.back().data;
+	}
+
+	/**
+	 * Allocates 'size' bytes between two quotes, like the strings of the input.
+	 * @return The first byte after the opening quote.
+	 */
+	char* allocate_quoted(size_t size) {
+		char* result = allocate(size + 2u);
+		result[0] = '"';
+		result[size + 1u] = '"';
+		return result + 1u;
+	}
+
+	/**
+	 * @return The copy of the bytes between two quotes.
+	 */
+	std::string_view copy_quoted(std::string_view bytes) {
+		char* result = allocate_quoted(bytes.size());
+		memcpy(result, bytes.data(), bytes.size());
+		return std::string_view(result, bytes.size());
+	}
+
+	size_t capacity() const noexcept {
+		size_t result = 0;
+		for(const auto& block : _blocks) {
+			result += block.size;
+		}
+		return result;
+	}
+
+	void clear() noexcept {
+		_block = 0;
+		_used = 0;
+	}
+
+};
+
+using StringArena = BasicStringArena<>;
+
+} // namespace jjson
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace jjson {
+
+/**
+ * Runs another block reader on a background thread, see PreadBlockReader for the interface.
+ * The blocks are copied to a ring of buffers, so e.g. the decompression of the next blocks
+ * overlaps the parsing of the current one:
+ *
+ * ThreadedBlockReader<DecompressBlockReader<FileBlockReader>> reader(2u, block_size);
+ *
+ * If the source has 'bool is_plain()' and it is true after open(), e.g. DecompressBlockReader of
+ * an uncompressed file, the blocks of the source are returned as they are, with no copy and no thread:
+ * the source reads ahead by itself.
+ * The thread is started by the first file which needs it and serves the next files until the reader is destroyed.
+ *
+ * @tparam R - the source block reader.
+ */
+template <typename R>
+class ThreadedBlockReader {
+
+	struct Buffer {
+		std::string data;
+		bool full = false;
+	};
+
+	template <typename S, typename = void>
+	struct HasIsPlain : std::false_type {};
+
+	template <typename S>
+	struct HasIsPlain<S, std::void_t<decltype(std::declval<const S&>().is_plain())> > : std::true_type {};
+
+	R _source;
+	std::vector<Buffer> _buffers;
+	size_t _current;
+	bool _has_current;
+	bool _eof;
+	/** The blocks of the source are returned directly. */
+	bool _direct;
+	/** A file is open and the thread reads it. */
+	bool _active;
+	/** The thread is in the source, the source can not be closed. */
+	bool _reading;
+	bool _quit;
+	/** Counts the files of the thread, it restarts at the first buffer on a new one. */
+	uint64_t _generation;
+	std::string _error;
+	std::mutex _mutex;
+	std::condition_variable _cv;
+	std::thread _thread;
+
+public:
+
+	ThreadedBlockReader(const ThreadedBlockReader&) = delete;
+	ThreadedBlockReader& operator=(const ThreadedBlockReader&) = delete;
+
+	ThreadedBlockReader(ThreadedBlockReader&& rv) = delete;
+	ThreadedBlockReader& operator=(ThreadedBlockReader&&) = delete;
+
+	/**
+	 * @param args - the arguments of the source reader constructor.
+	 */
+	template <typename... Args>
+	explicit ThreadedBlockReader(size_t buffer_count, Args&&... args) :
+		_source(std::forward<Args>(args)...),
+		_buffers(buffer_count < 2u ? 2u : buffer_count),
+		_current(0),
+		_has_current(false),
+		_eof(true),
+		_direct(false),
+		_active(false),
+		_reading(false),
+		_quit(false),
+		_generation(0) {}
+
+	~ThreadedBlockReader() noexcept {
+		close();
+		if(_thread.joinable()) {
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_quit = true;
+			}
+			_cv.notify_all();
+			_thread.join();
+		}
+	}
+
+	bool open(const char* file_name) {
+		close();
+		if(not _source.open(file_name)) {
+			_error = _source.error();
+			return false;
+		}
+		_error.clear();
+		_direct = is_plain(_source);
+		if(_direct) {
+			return true;
+		}
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_eof = false;
+			_current = 0;
+			_has_current = false;
+			for(auto& buffer : _buffers) {
+				buffer.full = false;
+			}
+			_generation++;
+			_active = true;
+		}
+		if(not _thread.joinable()) {
+			_thread = std::thread(&ThreadedBlockReader::run, this);
+		}
+		_cv.notify_all();
+		return true;
+	}
+
+	/**
+	 * Stops the reading of the file, the thread stays for the next one.
+	 */
+	void close() noexcept {
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_active = false;
+			_cv.notify_all();
+			_cv.wait(lock, [this]() { return not _reading; });
+		}
+		_source.close();
+	}
+
+	bool next(std::string_view& block) {
+		if(_direct) {
+			if(_source.next(block)) {
+				return true;
+			}
+			_error = _source.error();
+			return false;
+		}
+		std::unique_lock<std::mutex> lock(_mutex);
+		if(_has_current) {
+			_buffers[_current].full = false;
+			_current = (_current + 1u) % _buffers.size();
+			_has_current = false;
+			_cv.notify_all();
+		}
+		_cv.wait(lock, [this]() { return _buffers[_current].full || _eof || not _active; });
+		if(not _buffers[_current].full) {
+			return false;
+		}
+		_has_current = true;
+		block = _buffers[_current].data;
+		return true;
+	}
+
+	bool failed() const noexcept {
+		return not _error.empty();
+	}
+
+	const std::string& error() const noexcept {
+		return _error;
+	}
+
+	/**
+	 * The source must not be used while the reader is open.
+	 */
+	R& source() noexcept {
+		return _source;
+	}
+
+private:
+
+	static bool is_plain(const R& source) noexcept {
+		if constexpr (HasIsPlain<R>::value) {
+			return source.is_plain();
+		} else {
+			return false;
+		}
+	}
+
+	void run() {
+		size_t index = 0;
+		uint64_t generation = 0;
+		for(;;) {
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_cv.wait(lock, [this, index, generation]() {
+					return _quit || (_active && (generation != _generation || (not _eof && not _buffers[index].full)));
+				});
+				if(_quit) {
+					return;
+				}
+				if(generation != _generation) {
+					// The next file.
+					generation = _generation;
+					index = 0;
+					continue;
+				}
+				_reading = true;
+			}
+
+			// The buffer is not full, so it belongs to this thread.
+			std::string_view block;
+			const bool has_block = _source.next(block);
+			if(has_block) {
+				_buffers[index].data.assign(block.data(), block.size());
+			}
+
+			std::lock_guard<std::mutex> lock(_mutex);
+			_reading = false;
+			_cv.notify_all();
+			if(not _active) {
+				continue;
+			}
+			if(has_block) {
+				_buffers[index].full = true;
+				index = (index + 1u) % _buffers.size();
+			} else {
+				_error = _source.error();
+				_eof = true;
+			}
+		}
+	}
+
+};
+
+} // namespace jjson
@@ -0,0 +1,365 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace jjson {
+
+/**
+ * Reads a file in blocks with io_uring, see PreadBlockReader for the interface.
+ *
+ * The buffers of the ring are registered with the kernel and read with IORING_OP_READ_FIXED,
+ * if the registration is not permitted (RLIMIT_MEMLOCK) the plain IORING_OP_READ is used.
+ * All the buffers except the one held by the caller are always in flight, so the reads
+ * of the next blocks overlap the processing of the current one.
+ * open() returns false with an error if io_uring is not available, the failures of the reads
+ * fail next() with an "io_uring" error and delivered() tells where to resume, see FileBlockReader.
+ */
+class UringBlockReader {
+
+	struct Buffer {
+		std::unique_ptr<char[]> data;
+		size_t len = 0;
+		uint64_t offset = 0;
+		bool in_flight = false;
+		bool done = false;
+	};
+
+	struct Ring {
+		int fd = -1;
+		void* sq_ptr = MAP_FAILED;
+		size_t sq_len = 0;
+		void* cq_ptr = MAP_FAILED;
+		size_t cq_len = 0;
+		io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+		size_t sqes_len = 0;
+		unsigned* sq_head = nullptr;
+		unsigned* sq_tail = nullptr;
+		unsigned* sq_mask = nullptr;
+		unsigned* sq_array = nullptr;
+		unsigned* cq_head = nullptr;
+		unsigned* cq_tail = nullptr;
+		unsigned* cq_mask = nullptr;
+		io_uring_cqe* cqes = nullptr;
+	};
+
+	const size_t _block_size;
+	std::vector<Buffer> _buffers;
+	Ring _ring;
+	bool _registered;
+	int _fd;
+	uint64_t _file_size;
+	uint64_t _next_offset;
+	uint64_t _delivered;
+	size_t _current;
+	bool _has_current;
+	std::string _error;
+
+public:
+
+	UringBlockReader(const UringBlockReader&) = delete;
+	UringBlockReader& operator=(const UringBlockReader&) = delete;
+
+	UringBlockReader(UringBlockReader&& rv) = delete;
+	UringBlockReader& operator=(UringBlockReader&&) = delete;
+
+	explicit UringBlockReader(size_t block_size = 1024u * 1024u, size_t buffer_count = 2u) :
+		_block_size(block_size),
+		_buffers(buffer_count < 2u ? 2u : buffer_count),
+		_registered(false),
+		_fd(-1),
+		_file_size(0),
+		_next_offset(0),
+		_delivered(0),
+		_current(0),
+		_has_current(false) {
+		for(auto& buffer : _buffers) {
+			buffer.data.reset(new char[block_size]);
+		}
+	}
+
+	~UringBlockReader() noexcept {
+		close();
+		destroy_ring();
+	}
+
+	bool open(const char* file_name) {
+		close();
+		_error.clear();
+		if(_ring.fd < 0 && not create_ring()) {
+			return false;
+		}
+
+		_fd = ::open(file_name, O_RDONLY | O_CLOEXEC);
+		struct stat st;
+		if(_fd < 0 || fstat(_fd, &st) != 0) {
+			_error = std::string("open() : ") + strerror(errno);
+			close();
+			return false;
+		}
+		_file_size = uint64_t(st.st_size);
+		_next_offset = 0;
+		_delivered = 0;
+		_current = 0;
+		_has_current = false;
+
+		for(size_t i = 0; i < _buffers.size(); ++i) {
+			submit(i);
+		}
+		return enter(0) >= 0;
+	}
+
+	void close() noexcept {
+		// Drain the reads in flight before their buffers can be reused, also after an error.
+		while(in_flight()) {
+			if(submit_and_wait(1u) < 0) {
+				// The ring is not usable, its teardown cancels and waits for the reads.
+				destroy_ring();
+				break;
+			}
+			reap();
+		}
+		if(_fd >= 0) {
+			::close(_fd);
+			_fd = -1;
+		}
+		for(auto& buffer : _buffers) {
+			buffer.in_flight = false;
+			buffer.done = false;
+		}
+	}
+
+	bool next(std::string_view& block) {
+		if(_has_current) {
+			_has_current = false;
+			submit(_current);
+			_current = (_current + 1u) % _buffers.size();
+		}
+
+		Buffer& buffer = _buffers[_current];
+		while(buffer.in_flight && not buffer.done) {
+			if(enter(1u) < 0) {
+				return false;
+			}
+		}
+		if(not buffer.done || buffer.len == 0) {
+			return false;
+		}
+		_has_current = true;
+		_delivered = buffer.offset + buffer.len;
+		block = std::string_view(buffer.data.get(), buffer.len);
+		return true;
+	}
+
+	/**
+	 * @return The offset of the file after the blocks returned by next().
+	 */
+	uint64_t delivered() const noexcept {
+		return _delivered;
+	}
+
+	bool failed() const noexcept {
+		return not _error.empty();
+	}
+
+	const std::string& error() const noexcept {
+		return _error;
+	}
+
+	bool registered_buffers() const noexcept {
+		return _registered;
+	}
+
+private:
+
+	bool in_flight() const noexcept {
+		for(const auto& buffer : _buffers) {
+			if(buffer.in_flight && not buffer.done) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void submit(size_t index) noexcept {
+		Buffer& buffer = _buffers[index];
+		buffer.done = false;
+		buffer.len = 0;
+		if(_next_offset >= _file_size) {
+			buffer.in_flight = false;
+			return;
+		}
+		buffer.offset = _next_offset;
+		const uint64_t left = _file_size - _next_offset;
+		const size_t len = left < _block_size ? size_t(left) : _block_size;
+		_next_offset += len;
+		buffer.in_flight = true;
+		push_read(index, 0, len);
+	}
+
+	/**
+	 * Reads [buffer.offset + from, buffer.offset + from + len) into the buffer at 'from'.
+	 */
+	void push_read(size_t index, size_t from, size_t len) noexcept {
+		Buffer& buffer = _buffers[index];
+		const unsigned tail = *_ring.sq_tail;
+		const unsigned slot = tail & *_ring.sq_mask;
+		io_uring_sqe* sqe = &_ring.sqes[slot];
+		memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = _registered ? IORING_OP_READ_FIXED : IORING_OP_READ;
+		sqe->fd = _fd;
+		sqe->addr = reinterpret_cast<uint64_t>(buffer.data.get() + from);
+		sqe->len = unsigned(len);
+		sqe->off = buffer.offset + from;
+		sqe->buf_index = uint16_t(index);
+		sqe->user_data = (uint64_t(index) << 32u) | uint64_t(from + len);
+		_ring.sq_array[slot] = slot;
+		__atomic_store_n(_ring.sq_tail, tail + 1u, __ATOMIC_RELEASE);
+	}
+
+	/**
+	 * Submits the queued reads and waits for 'min_complete' completions.
+	 * @return Negative value on an error.
+	 */
+	int enter(unsigned min_complete) noexcept {
+		const int result = submit_and_wait(min_complete);
+		if(result < 0) {
+			_error = std::string("io_uring_enter() : ") + strerror(errno);
+			return result;
+		}
+		reap();
+		return _error.empty() ? 0 : -1;
+	}
+
+	/**
+	 * io_uring_enter() without the reaping.
+	 * @return Negative value on an error, see errno.
+	 */
+	int submit_and_wait(unsigned min_complete) noexcept {
+		if(_ring.fd < 0) {
+			errno = EBADF;
+			return -1;
+		}
+		const unsigned to_submit = *_ring.sq_tail - __atomic_load_n(_ring.sq_head, __ATOMIC_ACQUIRE);
+		int result;
+		do {
+			result = int(syscall(__NR_io_uring_enter, _ring.fd, to_submit, min_complete,
+				min_complete ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0));
+		} while(result < 0 && errno == EINTR);
+		return result;
+	}
+
+	void reap() noexcept {
+		unsigned head = *_ring.cq_head;
+		const unsigned tail = __atomic_load_n(_ring.cq_tail, __ATOMIC_ACQUIRE);
+		while(head != tail) {
+			const io_uring_cqe& cqe = _ring.cqes[head & *_ring.cq_mask];
+			const size_t index = size_t(cqe.user_data >> 32u);
+			const size_t end = size_t(cqe.user_data & 0xFFFFFFFFu);
+			Buffer& buffer = _buffers[index];
+			if(cqe.res < 0) {
+				_error = std::string("io_uring read : ") + strerror(-cqe.res);
+				buffer.done = true;
+			} else if(cqe.res == 0) {
+				// The file has shrunk.
+				buffer.done = true;
+			} else {
+				buffer.len += size_t(cqe.res);
+				if(buffer.len < end) {
+					// Short read, ask for the rest.
+					push_read(index, buffer.len, end - buffer.len);
+				} else {
+					buffer.done = true;
+				}
+			}
+			head++;
+		}
+		__atomic_store_n(_ring.cq_head, head, __ATOMIC_RELEASE);
+	}
+
+	bool create_ring() {
+		io_uring_params params;
+		memset(&params, 0, sizeof(params));
+		_ring.fd = int(syscall(__NR_io_uring_setup, unsigned(_buffers.size() * 2u), &params));
+		if(_ring.fd < 0) {
+			_error = std::string("io_uring_setup() : ") + strerror(errno);
+			return false;
+		}
+
+		_ring.sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		_ring.cq_len = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		if(params.features & IORING_FEAT_SINGLE_MMAP) {
+			_ring.sq_len = _ring.cq_len = std::max(_ring.sq_len, _ring.cq_len);
+		}
+		_ring.sq_ptr = mmap(nullptr, _ring.sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			_ring.fd, IORING_OFF_SQ_RING);
+		if(params.features & IORING_FEAT_SINGLE_MMAP) {
+			_ring.cq_ptr = _ring.sq_ptr;
+		} else {
+			_ring.cq_ptr = mmap(nullptr, _ring.cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+				_ring.fd, IORING_OFF_CQ_RING);
+		}
+		_ring.sqes_len = params.sq_entries * sizeof(io_uring_sqe);
+		_ring.sqes = static_cast<io_uring_sqe*>(mmap(nullptr, _ring.sqes_len, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, _ring.fd, IORING_OFF_SQES));
+		if(_ring.sq_ptr == MAP_FAILED || _ring.cq_ptr == MAP_FAILED || _ring.sqes == MAP_FAILED) {
+			_error = std::string("io_uring mmap() : ") + strerror(errno);
+			destroy_ring();
+			return false;
+		}
+
+		const auto sq = static_cast<char*>(_ring.sq_ptr);
+		const auto cq = static_cast<char*>(_ring.cq_ptr);
+		_ring.sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+		_ring.sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+		_ring.sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+		_ring.sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+		_ring.cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+		_ring.cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+		_ring.cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+		_ring.cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+		std::vector<iovec> iovecs(_buffers.size());
+		for(size_t i = 0; i < _buffers.size(); ++i) {
+			iovecs[i].iov_base = _buffers[i].data.get();
+			iovecs[i].iov_len = _block_size;
+		}
+		_registered = syscall(__NR_io_uring_register, _ring.fd, IORING_REGISTER_BUFFERS,
+			iovecs.data(), unsigned(iovecs.size())) == 0;
+		return true;
+	}
+
+	void destroy_ring() noexcept {
+		if(_ring.sqes != MAP_FAILED) {
+			munmap(_ring.sqes, _ring.sqes_len);
+		}
+		if(_ring.cq_ptr != MAP_FAILED && _ring.cq_ptr != _ring.sq_ptr) {
+			munmap(_ring.cq_ptr, _ring.cq_len);
+		}
+		if(_ring.sq_ptr != MAP_FAILED) {
+			munmap(_ring.sq_ptr, _ring.sq_len);
+		}
+		if(_ring.fd >= 0) {
+			::close(_ring.fd);
+		}
+		_ring = Ring();
+		_registered = false;
+	}
+
+};
+
+} // namespace jjson
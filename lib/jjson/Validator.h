@@ -0,0 +1,373 @@
+#pragma once
+
+#include <lib/jjson/PaddedInput.h>
+#include <lib/jjson/Kernels.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <endian.h>
+
+namespace jjson {
+
+/**
+ * Accepts or rejects a document without the events, the views and the allocations.
+ *
+ * Unlike Tokenizer it checks the whole RFC 8259 grammar: the number format, the escape sequences,
+ * the control characters and the UTF-8 of the strings, the bytes outside of the strings.
+ * The nesting is a bit stack of MAX_DEPTH bits in the object.
+ * The scans of the strings and the spaces and the UTF-8 check of the whole input are Kernels.
+ *
+ * IMPORTANT:
+ * - The input must be padded, see PaddedInput: the literals are compared as words.
+ *
+ * @tparam MAX_DEPTH - the limit of the nesting, the deeper documents are rejected.
+ */
+template <size_t MAX_DEPTH = 1024u>
+class Validator {
+
+	static_assert(MAX_DEPTH > 0 && MAX_DEPTH % 64u == 0, "MAX_DEPTH must be a multiple of 64");
+
+	/** A bit per open container, 1 is an object. */
+	uint64_t _stack[MAX_DEPTH / 64u];
+	const Kernels& _kernels;
+	const uint8_t* _begin;
+	const uint8_t* _end;
+	const char* _error;
+	size_t _error_offset;
+
+public:
+
+	Validator(const Validator&) = delete;
+	Validator& operator=(const Validator&) = delete;
+
+	Validator(Validator&& rv) = delete;
+	Validator& operator=(Validator&&) = delete;
+
+	Validator() noexcept : _kernels(Kernels::get()), _begin(nullptr), _end(nullptr), _error(""), _error_offset(0) {}
+
+	/**
+	 * @return The reason of the rejection of the last validate(), an empty string if it has been accepted.
+	 */
+	const char* error() const noexcept {
+		return _error;
+	}
+
+	/**
+	 * @return The offset of the byte which has failed the last validate(), zero if it has been accepted.
+	 */
+	size_t error_offset() const noexcept {
+		return _error_offset;
+	}
+
+	bool validate(const PaddedInput& input) noexcept {
+		reset();
+		_begin = reinterpret_cast<const uint8_t*>(input.data());
+		_end = _begin + input.size();
+
+		// The grammar goes first, an invalid UTF-8 sequence before its error is reported instead.
+		const bool valid = grammar();
+		const uint8_t* checked = valid ? _end : _begin + _error_offset;
+		const uint8_t* invalid = _kernels.validate_utf8(_begin, checked);
+		if(invalid != checked) {
+			return fail(invalid, "invalid UTF-8");
+		}
+		return valid;
+	}
+
+private:
+
+	bool grammar() noexcept {
+		const uint8_t* p = _begin;
+		size_t depth = 0;
+
+	value:
+		p = skip_ws(p);
+		if(p == _end) {
+			return fail(p, depth ? "unexpected end of the input" : "empty document");
+		}
+		switch(*p) {
+			case '{':
+				p = skip_ws(p + 1u);
+				if(p < _end && *p == '}') {
+					p++;
+					goto after_value;
+				}
+				if(depth == MAX_DEPTH) {
+					return fail(p, "too deep nesting");
+				}
+				push(depth++, true);
+				goto object_key;
+
+			case '[':
+				p = skip_ws(p + 1u);
+				if(p < _end && *p == ']') {
+					p++;
+					goto after_value;
+				}
+				if(depth == MAX_DEPTH) {
+					return fail(p, "too deep nesting");
+				}
+				push(depth++, false);
+				goto value;
+
+			case '"':
+				p = string(p);
+				if(p == nullptr) {
+					return false;
+				}
+				goto after_value;
+
+			case '-':
+			case '0'...'9':
+				p = number(p);
+				if(p == nullptr) {
+					return false;
+				}
+				goto after_value;
+
+			case 't':
+				p = literal(p, "true");
+				if(p == nullptr) {
+					return false;
+				}
+				goto after_value;
+
+			case 'f':
+				p = literal(p, "false");
+				if(p == nullptr) {
+					return false;
+				}
+				goto after_value;
+
+			case 'n':
+				p = literal(p, "null");
+				if(p == nullptr) {
+					return false;
+				}
+				goto after_value;
+
+			default:
+				return fail(p, "unexpected character, a value is expected");
+		}
+
+	object_key:
+		if(p == _end || *p != '"') {
+			return fail(p, "a key is expected");
+		}
+		p = string(p);
+		if(p == nullptr) {
+			return false;
+		}
+		p = skip_ws(p);
+		if(p == _end || *p != ':') {
+			return fail(p, "':' is expected");
+		}
+		p++;
+		goto value;
+
+	after_value:
+		p = skip_ws(p);
+		if(depth == 0) {
+			return p == _end ? true : fail(p, "unexpected character after the document");
+		}
+		if(p == _end) {
+			return fail(p, "unexpected end of the input");
+		}
+		if(*p == ',') {
+			if(top(depth)) {
+				p = skip_ws(p + 1u);
+				goto object_key;
+			}
+			p++;
+			goto value;
+		}
+		if(*p == (top(depth) ? '}' : ']')) {
+			p++;
+			depth--;
+			goto after_value;
+		}
+		return fail(p, top(depth) ? "',' or '}' is expected" : "',' or ']' is expected");
+	}
+
+	/**
+	 * Forgets the error of the previous input.
+	 */
+	void reset() noexcept {
+		_error = "";
+		_error_offset = 0;
+	}
+
+	bool fail(const uint8_t* p, const char* error) noexcept {
+		_error = error;
+		_error_offset = p - _begin;
+		return false;
+	}
+
+	void push(size_t depth, bool is_object) noexcept {
+		const uint64_t bit = uint64_t(1u) << (depth % 64u);
+		uint64_t& word = _stack[depth / 64u];
+		word = is_object ? (word | bit) : (word & ~bit);
+	}
+
+	/**
+	 * @return true if the innermost open container is an object.
+	 */
+	bool top(size_t depth) const noexcept {
+		depth--;
+		return (_stack[depth / 64u] >> (depth % 64u)) & 1u;
+	}
+
+	const uint8_t* skip_ws(const uint8_t* p) const noexcept {
+		// Most of the tokens are not preceded by a space.
+		if(p < _end && *p > ' ') {
+			return p;
+		}
+		return _kernels.skip_whitespace(p, _end);
+	}
+
+	/**
+	 * Compares the literal as a word, the padding keeps the load inside the buffer.
+	 */
+	template <size_t N>
+	const uint8_t* literal(const uint8_t* p, const char (&word)[N]) noexcept {
+		constexpr size_t len = N - 1u;
+		uint64_t input = 0;
+		uint64_t expected = 0;
+		memcpy(&input, p, len);
+		memcpy(&expected, word, len);
+		if(size_t(_end - p) < len || input != expected) {
+			fail(p, "invalid literal");
+			return nullptr;
+		}
+		return p + len;
+	}
+
+	/**
+	 * -? (0 | [1-9][0-9]*) (.[0-9]+)? ([eE][+-]?[0-9]+)?
+	 */
+	const uint8_t* number(const uint8_t* p) noexcept {
+		if(*p == '-') {
+			p++;
+		}
+		if(p == _end || not is_digit(*p)) {
+			fail(p, "invalid number, a digit is expected");
+			return nullptr;
+		}
+		if(*p == '0') {
+			p++;
+		} else {
+			p = digits(p);
+		}
+		if(p < _end && *p == '.') {
+			p++;
+			if(p == _end || not is_digit(*p)) {
+				fail(p, "invalid number, a digit of the fraction is expected");
+				return nullptr;
+			}
+			p = digits(p);
+		}
+		if(p < _end && (*p == 'e' || *p == 'E')) {
+			p++;
+			if(p < _end && (*p == '+' || *p == '-')) {
+				p++;
+			}
+			if(p == _end || not is_digit(*p)) {
+				fail(p, "invalid number, a digit of the exponent is expected");
+				return nullptr;
+			}
+			p = digits(p);
+		}
+		return p;
+	}
+
+	static bool is_digit(uint8_t c) noexcept {
+		return uint8_t(c - '0') < 10u;
+	}
+
+	/**
+	 * Eight digits a step: a byte is a digit if both c and c + 6 are in 0x30..0x3F.
+	 * A carry out of a byte comes from a non digit, which is found first.
+	 */
+	const uint8_t* digits(const uint8_t* p) const noexcept {
+		constexpr uint64_t HIGH = 0xF0F0F0F0F0F0F0F0ull;
+		constexpr uint64_t ZEROES = 0x3030303030303030ull;
+		constexpr uint64_t SIXES = 0x0606060606060606ull;
+		while(_end - p >= 8) {
+			uint64_t word;
+			memcpy(&word, p, sizeof(word));
+			word = le64toh(word);
+			const uint64_t other = ((word & HIGH) ^ ZEROES) | (((word + SIXES) & HIGH) ^ ZEROES);
+			if(other) {
+				return p + (__builtin_ctzll(other) >> 3u);
+			}
+			p += 8u;
+		}
+		while(p < _end && is_digit(*p)) {
+			p++;
+		}
+		return p;
+	}
+
+	static bool is_hex(uint8_t c) noexcept {
+		return is_digit(c) || uint8_t((c | 0x20u) - 'a') < 6u;
+	}
+
+	/**
+	 * The bytes above 0x7F are checked by validate(), the scan stops only on '"', '\' and the control characters.
+	 * @return The first byte after the closing quote or nullptr.
+	 */
+	const uint8_t* string(const uint8_t* p) noexcept {
+		p++;
+		while(true) {
+			p = _kernels.find_escape(p, _end);
+			if(p == _end) {
+				fail(_end, "unterminated string");
+				return nullptr;
+			}
+			if(*p == '"') {
+				return p + 1u;
+			}
+			if(*p != '\\') {
+				fail(p, "control character in a string");
+				return nullptr;
+			}
+			p = escape(p);
+			if(p == nullptr) {
+				return nullptr;
+			}
+		}
+	}
+
+	const uint8_t* escape(const uint8_t* p) noexcept {
+		if(p + 1u >= _end) {
+			fail(p, "unterminated string");
+			return nullptr;
+		}
+		switch(p[1]) {
+			case '"':
+			case '\\':
+			case '/':
+			case 'b':
+			case 'f':
+			case 'n':
+			case 'r':
+			case 't':
+				return p + 2u;
+
+			case 'u':
+				if(_end - p < 6 || not (is_hex(p[2]) && is_hex(p[3]) && is_hex(p[4]) && is_hex(p[5]))) {
+					fail(p, "invalid \\u escape sequence");
+					return nullptr;
+				}
+				return p + 6u;
+
+			default:
+				fail(p, "invalid escape sequence");
+				return nullptr;
+		}
+	}
+
+};
+
+} // namespace jjson
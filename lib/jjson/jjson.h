@@ -1,10 +1,25 @@
 #pragma once
 
 #include <lib/jjson/type.h>
+#include <lib/jjson/CpuFeatures.h>
+#include <lib/jjson/Kernels.h>
 #include <lib/jjson/Tokenizer.h>
 
 #include <lib/jjson/SaxParser.h>
 #include <lib/jjson/SaxStringBuilder.h>
+#include <lib/jjson/SaxBatch.h>
+#include <lib/jjson/SaxTransform.h>
+#include <lib/jjson/Validator.h>
+#include <lib/jjson/Canonical.h>
+#include <lib/jjson/Prefilter.h>
 
 #include <lib/jjson/DomBuilder.h>
+#include <lib/jjson/DomEditor.h>
+#include <lib/jjson/DomIterator.h>
 #include <lib/jjson/DomJsonStringBuilder.h>
+#include <lib/jjson/DomIovecBuilder.h>
+#include <lib/jjson/JsonWriter.h>
+#include <lib/jjson/DomCache.h>
+#include <lib/jjson/ParseContext.h>
+#include <lib/jjson/ColumnarBuilder.h>
+#include <lib/jjson/pmr.h>
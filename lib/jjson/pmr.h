@@ -0,0 +1,83 @@
+#pragma once
+
+#include <lib/jjson/type.h>
+#include <lib/jjson/SaxParser.h>
+#include <lib/jjson/DomBuilder.h>
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+namespace jjson {
+namespace pmr {
+
+/**
+ * The builder and the parser which take all their memory from a std::pmr::memory_resource.
+ * Pass the allocator to the constructors:
+ *
+ * jjson::pmr::Arena arena(64 * 1024);
+ * jjson::pmr::DomBuilder dom(capacity, arena.allocator<Node>());
+ * jjson::pmr::SaxParser<jjson::pmr::DomBuilder> parser(dom, arena.allocator<char>());
+ */
+using DomBuilder = jjson::DomBuilder<std::pmr::polymorphic_allocator<Node> >;
+
+template <typename T, typename S = DefaultStatistics>
+using SaxParser = jjson::SaxParser<T, S, std::pmr::polymorphic_allocator<char> >;
+
+/**
+ * Monotonic arena which holds everything allocated during a request and releases it in one reset().
+ * The initial buffer is kept between the requests, so a request which fits it does not touch the heap.
+ *
+ * IMPORTANT:
+ * - The builders and the parsers using the arena must be destroyed before reset().
+ */
+class Arena {
+
+	const size_t _initial_size;
+	std::unique_ptr<std::byte[]> _buffer;
+	std::pmr::monotonic_buffer_resource _resource;
+
+public:
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	Arena(Arena&& rv) = delete;
+	Arena& operator=(Arena&&) = delete;
+
+	explicit Arena(size_t initial_size, std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) :
+		_initial_size(initial_size),
+		_buffer(new std::byte[initial_size]),
+		_resource(_buffer.get(), initial_size, upstream) {}
+
+	~Arena() noexcept = default;
+
+	std::pmr::memory_resource* resource() noexcept {
+		return &_resource;
+	}
+
+	template <typename T>
+	std::pmr::polymorphic_allocator<T> allocator() noexcept {
+		return std::pmr::polymorphic_allocator<T>(&_resource);
+	}
+
+	size_t initial_size() const noexcept {
+		return _initial_size;
+	}
+
+	void reset() noexcept {
+		_resource.release();
+	}
+
+};
+
+/**
+ * @return The pool of the calling thread, use it to recycle the memory of many short-lived builders.
+ */
+inline std::pmr::memory_resource* thread_local_pool() noexcept {
+	thread_local std::pmr::unsynchronized_pool_resource pool;
+	return &pool;
+}
+
+} // namespace pmr
+} // namespace jjson
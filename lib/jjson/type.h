@@ -18,11 +18,56 @@ enum class NodeType : char {
 	Unknown
 };
 
+/**
+ * The children of Object and Array are the 'value' list linked by 'next', the value of Key is 'value'.
+ *
+ * key_id - the id of a Key node in the KeyTable of DomBuilder or NO_KEY_ID.
+ * child_count - the length of the list of Object and Array.
+ * CONTIGUOUS - the children are adjacent in the pool, value[i] is the child i, see DomBuilder::set_contiguous().
+ * The extra fields fit the padding, the node stays 40 bytes.
+ */
 struct Node {
+	static constexpr uint32_t NO_KEY_ID = UINT32_MAX;
+	static constexpr uint8_t CONTIGUOUS = 1u;
+
 	Node* next;
 	Node* value;
 	std::string_view data;
+	union {
+		uint32_t key_id;
+		uint32_t child_count;
+	};
 	NodeType type;
+	uint8_t flags;
+
+	bool is_container() const noexcept {
+		return type == NodeType::Object || type == NodeType::Array;
+	}
+
+	/**
+	 * @return The number of the children of Object and Array, 0 for the other types.
+	 */
+	size_t size() const noexcept {
+		return is_container() ? child_count : 0;
+	}
+
+	/**
+	 * @return The element 'index' of Array or the key 'index' of Object, nullptr if it is out of the range.
+	 * O(1) for the contiguous children, O(index) otherwise.
+	 */
+	const Node* at(size_t index) const noexcept {
+		if(index >= size()) {
+			return nullptr;
+		}
+		if(flags & CONTIGUOUS) {
+			return value + index;
+		}
+		const Node* result = value;
+		while(index--) {
+			result = result->next;
+		}
+		return result;
+	}
 };
 
 enum class TokenType : uint8_t {
@@ -1,70 +1,28 @@
 #include <cstdio>
 
 #include <lib/jjson/jjson.h>
+#include <lib/jjson/FileBlockReader.h>
+#include <lib/jjson/DecompressBlockReader.h>
+#include <lib/jjson/ThreadedBlockReader.h>
+#include <lib/jjson/DocumentSplitter.h>
 #include <cassert>
 
-using namespace jjson;
-
-bool test_sax_string_builder(const std::string& input) noexcept {
-	bool result = false;
-	SaxStringBuilder builder;
-	SaxParser parser(builder);
-	result = parser.parse(input);
-	if (result) {
-		const std::string& output = builder.output();
-		result = (strcmp(input.data(), output.data()) == 0);
-		if (not result) {
-			fprintf(stderr, "SaxStringBuilder test has failed : the input and output strings are not the same!\n");
-			fprintf(stderr, "input  : '%s'\n", input.c_str());
-			fprintf(stderr, "output : '%s'\n", output.c_str());
-		}
-	}
-	else {
-		const std::string& output = parser.error();
-		fprintf(stderr, "SaxStringBuilder test has failed during the parsing!\n");
-		fprintf(stderr, "input  : '%s'\n", input.c_str());
-		fprintf(stderr, "error  : '%s'\n", parser.error().c_str());
-	}
-	return result;
-}
-
-bool test_dom_string_builder(const std::string& input) noexcept {
-	bool result = false;
-	DomBuilder dom(1024 * 1024);
-	SaxParser parser(dom);
-	result = parser.parse(input);
-	if (result) {
-		const auto root = dom.root();
-		const std::string& output = DomJsonStringBuilder::to_json_string(root);
-		result = (strcmp(input.data(), output.data()) == 0);
-		if (not result) {
-			fprintf(stderr, "DomStringBuilder test has failed : the input and output strings are not the same!\n");
-			fprintf(stderr, "input  : '%s'\n", input.c_str());
-			fprintf(stderr, "output : '%s'\n", output.c_str());
-		}
-	} else {
-		if(dom.is_allocation_reject()) {
-			fprintf(stderr, "DomStringBuilder test has failed, the node pool is empty!\n");
-		} else {
-			const std::string& output = parser.error();
-			fprintf(stderr, "DomStringBuilder test has failed during the parsing!\n");
-			fprintf(stderr, "input  : '%s'\n", input.c_str());
-			fprintf(stderr, "error  : '%s'\n", output.c_str());
-		}
-
-	}
-	return result;
-}
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
 
+using namespace jjson;
 
-void remove_junk(std::string& input) {
+void remove_junk(PaddedInput& input) {
 	while (input.size() > 0) {
-		switch (input.back()) {
+		switch (input.data()[input.size() - 1u]) {
 			case 0:
 			case ' ':
 			case '\r':
 			case '\n':
-				input.pop_back();
+				input = input.prefix(input.size() - 1u);
 			continue;
 
 			default:
@@ -74,56 +32,315 @@ void remove_junk(std::string& input) {
 	}
 }
 
-bool process_file(FILE* file) noexcept {
-	fseek(file, 0, SEEK_END);
-	const auto file_size = size_t(ftell(file));
-	fseek(file, 0, SEEK_SET);
+/**
+ * Runs the round trip tests over the files, the parsers and the buffers are reused between the files.
+ * The next file is read and decompressed in the background while the current one is tested.
+ * The check only mode runs jjson::Validator alone.
+ */
+class FileValidator {
+
+	static constexpr size_t DOM_CAPACITY = 1024 * 1024;
+	static constexpr size_t READ_BLOCK_SIZE = 1024 * 1024;
+
+	using Reader = ThreadedBlockReader<DecompressBlockReader<FileBlockReader>>;
 
-	std::string input;
-	input.resize(file_size + 1u);
-	input[file_size] = 0;
+	struct Slot {
+		Reader reader;
+		DocumentSplitter<Reader> splitter;
+		const char* file_name;
+		bool opened;
 
-	bool result = (fread(&(input.front()), file_size, 1, file) == 1);
-	if(result) {
-		// Remove all the junk which "SMART EDITORS" put at the end of the file.
-		remove_junk(input);
-		result = test_sax_string_builder(input) && test_dom_string_builder(input);
-	} else {
-		fprintf(stderr, "File size mismatch.\n");
+		explicit Slot(FileBlockReader::Backend backend) :
+			reader(2u, READ_BLOCK_SIZE, READ_BLOCK_SIZE, 2u, backend), splitter(reader), file_name(nullptr), opened(false) {}
+	};
+
+	Validator<> _validator;
+	SaxStringBuilder _sax_builder;
+	SaxParser<SaxStringBuilder> _sax_parser;
+	DomBuilder<> _dom;
+	SaxParser<DomBuilder<>> _dom_parser;
+	std::unique_ptr<Slot> _slots[2];
+	size_t _current;
+	size_t _next;
+	size_t _input_size;
+	std::string _error;
+	bool _check_only;
+
+public:
+
+	FileValidator(FileBlockReader::Backend backend, bool check_only) noexcept :
+		_sax_parser(_sax_builder),
+		_dom(DOM_CAPACITY),
+		_dom_parser(_dom),
+		_slots{std::make_unique<Slot>(backend), std::make_unique<Slot>(backend)},
+		_current(0),
+		_next(0),
+		_input_size(0),
+		_check_only(check_only) {}
+
+	const std::string& error() const noexcept {
+		return _error;
 	}
 
-	return result;
+	size_t input_size() const noexcept {
+		return _input_size;
+	}
 
-}
+	/**
+	 * Starts reading the file, at most two files may wait for process().
+	 */
+	void prefetch(const char* file_name) noexcept {
+		Slot& slot = *_slots[_next];
+		_next ^= 1u;
+		slot.file_name = file_name;
+		slot.opened = slot.reader.open(file_name);
+		slot.splitter.reset();
+	}
+
+	/**
+	 * Tests the oldest prefetched file.
+	 */
+	bool process() noexcept {
+		Slot& slot = *_slots[_current];
+		_current ^= 1u;
+		_error.clear();
+		_input_size = 0;
+
+		bool result = false;
+		if (slot.opened) {
+			PaddedInput input;
+			result = slot.splitter.next(input);
+			_input_size = slot.splitter.bytes_read();
+			if (slot.reader.failed()) {
+				append_error("File '", slot.file_name, "' read has failed : ", slot.reader.error(), "\n");
+				result = false;
+			} else if (not result) {
+				append_error("File '", slot.file_name, "' is empty.\n");
+			} else {
+				// Remove all the junk which "SMART EDITORS" put at the end of the file.
+				remove_junk(input);
+				result = test_validator(input);
+				if(result && not _check_only) {
+					result = test_sax_string_builder(input) && test_dom_string_builder(input);
+				}
+			}
+			slot.reader.close();
+		}
+		else {
+			append_error("File '", slot.file_name, "' is not available for reading : ", slot.reader.error(), "\n");
+		}
+		return result;
+	}
+
+private:
+
+	template <typename... Args>
+	void append_error(const Args&... args) {
+		(_error.append(args), ...);
+	}
+
+	bool test_validator(PaddedInput padded) noexcept {
+		const bool result = _validator.validate(padded);
+		if (not result) {
+			char offset[32];
+			snprintf(offset, sizeof(offset), "%zu", _validator.error_offset());
+			append_error("Validator test has failed at the offset ", offset, " : ", _validator.error(), "\n");
+		}
+		return result;
+	}
 
-int process_file_name(const char* file_name) noexcept {
-	int result = EXIT_FAILURE;
-	auto file = fopen(file_name, "r");
-	if (file) {
-		result = process_file(file);
-		fclose(file);
+	bool test_sax_string_builder(PaddedInput padded) noexcept {
+		bool result = _sax_parser.parse(padded);
+		const std::string_view input = padded.view();
+		if (result) {
+			const std::string& output = _sax_builder.output();
+			result = (input == output);
+			if (not result) {
+				append_error("SaxStringBuilder test has failed : the input and output strings are not the same!\n");
+				append_error("input  : '", input, "'\n");
+				append_error("output : '", output, "'\n");
+			}
+		}
+		else {
+			append_error("SaxStringBuilder test has failed during the parsing!\n");
+			append_error("input  : '", input, "'\n");
+			append_error("error  : '", _sax_parser.error(), "'\n");
+		}
+		return result;
 	}
-	else {
-		fprintf(stderr, "File '%s' is not available for reading.\n", file_name);
+
+	bool test_dom_string_builder(PaddedInput padded) noexcept {
+		bool result = _dom_parser.parse(padded);
+		const std::string_view input = padded.view();
+		if (result) {
+			const auto root = _dom.root();
+			std::string output;
+			if (not DomJsonStringBuilder::to_json_string(root, output)) {
+				append_error("DomStringBuilder test has failed, the document is too deep to serialize!\n");
+				append_error("input  : '", input, "'\n");
+				return false;
+			}
+			result = (input == output);
+			if (not result) {
+				append_error("DomStringBuilder test has failed : the input and output strings are not the same!\n");
+				append_error("input  : '", input, "'\n");
+				append_error("output : '", output, "'\n");
+			}
+		} else {
+			if(_dom.is_allocation_reject()) {
+				append_error("DomStringBuilder test has failed, the node pool is empty!\n");
+			} else {
+				append_error("DomStringBuilder test has failed during the parsing!\n");
+				append_error("input  : '", input, "'\n");
+				append_error("error  : '", _dom_parser.error(), "'\n");
+			}
+		}
+		return result;
+	}
+
+};
+
+/**
+ * Spreads the files across a pool of threads, each thread owns its FileValidator.
+ * All the files are processed regardless of the failures.
+ */
+int process_batch(char** file_names, size_t file_count, unsigned thread_count, bool quiet,
+		FileBlockReader::Backend backend, bool check_only) {
+	struct Failure {
+		const char* file_name;
+		std::string error;
+	};
+
+	std::atomic<size_t> next_file(0);
+	std::atomic<size_t> bytes_total(0);
+	std::mutex report_mutex;
+	std::vector<Failure> failures;
+	ParserStatistics statistics = ParserStatistics();
+
+	const auto worker = [&]() {
+		FileValidator validator(backend, check_only);
+		size_t bytes = 0;
+		size_t index = next_file.fetch_add(1u, std::memory_order_relaxed);
+		if(index < file_count) {
+			validator.prefetch(file_names[index]);
+		}
+		while(index < file_count) {
+			const char* file_name = file_names[index];
+			index = next_file.fetch_add(1u, std::memory_order_relaxed);
+			if(index < file_count) {
+				validator.prefetch(file_names[index]);
+			}
+			const bool passed = validator.process();
+			bytes += validator.input_size();
+
+			std::lock_guard<std::mutex> lock(report_mutex);
+			if(passed) {
+				if(not quiet) {
+					printf("PASS %s\n", file_name);
+				}
+			} else {
+				printf("FAIL %s\n", file_name);
+				failures.push_back({file_name, validator.error()});
+			}
+		}
+		bytes_total.fetch_add(bytes, std::memory_order_relaxed);
+
+		if constexpr (DefaultStatistics::ENABLED) {
+			std::lock_guard<std::mutex> lock(report_mutex);
+			statistics.merge(ThreadLocalStatistics::snapshot());
+		}
+	};
+
+	const auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads;
+	for(unsigned i = 0; i < thread_count; ++i) {
+		threads.emplace_back(worker);
 	}
-	return result;
+	for(auto& thread : threads) {
+		thread.join();
+	}
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	const double seconds = elapsed.count() > 0 ? elapsed.count() : 1e-9;
+	const double megabytes = double(bytes_total.load()) / (1024.0 * 1024.0);
+	printf("\nfiles=%zu passed=%zu failed=%zu threads=%u\n",
+		file_count, file_count - failures.size(), failures.size(), thread_count);
+	printf("time=%.3fs throughput=%.1f files/s %.2f MB/s (%.2f MB)\n",
+		seconds, double(file_count) / seconds, megabytes / seconds, megabytes);
+	if constexpr (DefaultStatistics::ENABLED) {
+		statistics.dump(stdout);
+	}
+
+	if(not failures.empty()) {
+		fflush(stdout);
+		fprintf(stderr, "\nFailures:\n");
+		for(const auto& failure : failures) {
+			fprintf(stderr, "--- %s\n%s", failure.file_name, failure.error.c_str());
+		}
+	}
+
+	return failures.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 int main(int argc, char** argv) {
-	if (argc < 2) {
-		fprintf(stderr, "usage : json-file-name(s)\n");
+	unsigned thread_count = 0;
+	bool quiet = false;
+	bool check_only = false;
+	auto backend = FileBlockReader::Backend::Uring;
+	int arg = 1;
+	for (; arg < argc && argv[arg][0] == '-'; ++arg) {
+		if (strcmp(argv[arg], "-j") == 0 && arg + 1 < argc) {
+			thread_count = unsigned(atoi(argv[++arg]));
+			if (thread_count == 0) {
+				thread_count = std::thread::hardware_concurrency();
+			}
+		} else if (strcmp(argv[arg], "-q") == 0) {
+			quiet = true;
+		} else if (strcmp(argv[arg], "-c") == 0) {
+			check_only = true;
+		} else if (strcmp(argv[arg], "-r") == 0 && arg + 1 < argc && strcmp(argv[arg + 1], "uring") == 0) {
+			backend = FileBlockReader::Backend::Uring;
+			arg++;
+		} else if (strcmp(argv[arg], "-r") == 0 && arg + 1 < argc && strcmp(argv[arg + 1], "pread") == 0) {
+			backend = FileBlockReader::Backend::Pread;
+			arg++;
+		} else {
+			break;
+		}
+	}
+
+	if (arg >= argc) {
+		fprintf(stderr, "usage : [-r uring|pread] [-c] [-j threads [-q]] json-file-name(s)\n");
+		fprintf(stderr, "\t-r : the file reader, io_uring falls back to pread if it is not available\n");
+		fprintf(stderr, "\t-c : check only, accept or reject the files without the round trip tests\n");
+		fprintf(stderr, "\t-j threads : batch mode, 0 means a thread per CPU\n");
+		fprintf(stderr, "\t-q : do not report the passed files in batch mode\n");
 		return EXIT_FAILURE;
 	}
 
+	if (thread_count > 0) {
+		return process_batch(argv + arg, size_t(argc - arg), thread_count, quiet, backend, check_only);
+	}
+
 	int err = EXIT_SUCCESS;
-	for (int arg = 1; arg < argc; ++arg) {
+	FileValidator validator(backend, check_only);
+	validator.prefetch(argv[arg]);
+	for (; arg < argc; ++arg) {
 		const auto file_name = argv[arg];
-		if (not process_file_name(file_name)) {
+		if (arg + 1 < argc) {
+			validator.prefetch(argv[arg + 1]);
+		}
+		if (not validator.process()) {
+			fprintf(stderr, "%s", validator.error().c_str());
 			fprintf(stderr, "The test has filed at file '%s'\n", file_name);
 			err = EXIT_FAILURE;
 			break;
 		}
 	}
 
+	if constexpr (DefaultStatistics::ENABLED) {
+		ThreadLocalStatistics::snapshot().dump(stdout);
+	}
+
 	return err;
 }
@@ -1,6 +1,2 @@
 #!/bin/bash
-for filename in ./json-test/*.json; do
-	echo "$filename"
-	./cmake-build-debug/validator "$filename"
-done
-
+./cmake-build-debug/validator -j 0 ./json-test/*.json